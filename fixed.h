@@ -25,8 +25,16 @@ SOFTWARE.
 #pragma once
 #include <compare>
 #include <concepts>
+#include <cstdint>
+#include <functional>
 #include <limits>
 #include <type_traits>
+#include <utility>
+
+// define SUPSM_FIXED_NO_INTRINSICS to always use the portable algorithms
+#if !defined(SUPSM_FIXED_NO_INTRINSICS) && defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
 
 namespace supsm
 {
@@ -34,6 +42,235 @@ namespace supsm
 	{
 		template<typename T, typename T2>
 		concept integer_or_T = std::integral<T> || std::same_as<T, T2>;
+		// integer types accepted by std::cmp_less and friends
+		template<typename T>
+		concept comparable_integer = std::integral<T> && !std::same_as<std::remove_cv_t<T>, bool> && !std::same_as<std::remove_cv_t<T>, char> &&
+			!std::same_as<std::remove_cv_t<T>, wchar_t> && !std::same_as<std::remove_cv_t<T>, char8_t> && !std::same_as<std::remove_cv_t<T>, char16_t> && !std::same_as<std::remove_cv_t<T>, char32_t>;
+		
+		// all 1's if the highest bit of x is set, otherwise 0
+		template<typename UT>
+		constexpr UT sign_mask(UT x)
+		{
+			return static_cast<UT>(-(x >> (std::numeric_limits<UT>::digits - 1)));
+		}
+		// two's complement negation of x if mask is all 1's, x if mask is 0
+		template<typename UT>
+		constexpr UT negate_if(UT x, UT mask)
+		{
+			return static_cast<UT>((x ^ mask) - mask);
+		}
+		
+		// two words of UT, most significant first
+		template<typename UT>
+		struct double_word
+		{
+			UT high;
+			UT low;
+		};
+		
+		template<typename UT>
+		struct div_result
+		{
+			UT quotient;
+			UT remainder;
+		};
+
+#if defined(__SIZEOF_INT128__)
+		// __extension__ silences -Wpedantic
+		__extension__ typedef unsigned __int128 uint128;
+#endif
+		
+		// next wider native unsigned type, if UT is a native integer of at most 32 bits
+		// void otherwise
+		template<typename UT>
+		using wider_unsigned_t =
+			std::conditional_t<!std::is_integral_v<UT>, void,
+			std::conditional_t<(std::numeric_limits<UT>::digits <= 8), std::uint16_t,
+			std::conditional_t<(std::numeric_limits<UT>::digits <= 16), std::uint32_t,
+			std::conditional_t<(std::numeric_limits<UT>::digits <= 32), std::uint64_t, void>>>>;
+		
+		// whether runtime code may use 128-bit intrinsics for UT
+		template<typename UT>
+		constexpr bool has_intrinsic_u128 =
+#if defined(SUPSM_FIXED_NO_INTRINSICS)
+			false;
+#elif defined(__SIZEOF_INT128__) || (defined(_MSC_VER) && defined(_M_X64))
+			std::is_integral_v<UT> && std::is_unsigned_v<UT> && std::numeric_limits<UT>::digits == 64;
+#else
+			false;
+#endif
+		
+		// full product of a and b using half-size long multiplication
+		// works for any unsigned UT, including custom types
+		template<typename UT>
+		constexpr double_word<UT> mul_wide_portable(UT a, UT b)
+		{
+			// divide total bits by 2, rounding up
+			constexpr auto low_bits_num = std::numeric_limits<UT>::digits / 2;
+			auto high_bits = [](UT x) { return static_cast<UT>(x >> low_bits_num); };
+			auto low_bits = [](UT x) { return static_cast<UT>(x & ((UT(1) << low_bits_num) - 1)); };
+			
+			// long multiplication
+			//       H1 L1
+			// x     H2 L2
+			// -----------
+			//        L1L2
+			//     H1L2  |
+			//     H2L1  |
+			//  H1H2  |  |
+			//  E1L2  |  |
+			//  L1E2  |  |
+			// R3 R2 R1 R0
+			const UT L1_L2 = low_bits(a) * low_bits(b);
+			// lowest bits of result
+			const UT result_0 = low_bits(L1_L2);
+			// keep H1L2 and L1H2 separate to prevent overflow
+			const UT H1_L2_C = high_bits(a) * low_bits(b) + high_bits(L1_L2);
+			// we only add low bits of H1_L2_C as a carry so no risk of overflow
+			const UT L1_H2_C = low_bits(a) * high_bits(b) + low_bits(H1_L2_C);
+			const UT result_1 = low_bits(L1_H2_C);
+			// very narrowly still guaranteed overflow-free
+			// (n-1)^2 + 2n = n^2-1
+			const UT H1_H2_C = high_bits(a) * high_bits(b) + high_bits(H1_L2_C) + high_bits(L1_H2_C);
+			const UT result_2 = low_bits(H1_H2_C);
+			const UT result_3 = high_bits(H1_H2_C);
+			
+			return { static_cast<UT>(result_2 | (result_3 << low_bits_num)), static_cast<UT>(result_0 | (result_1 << low_bits_num)) };
+		}
+		
+		// full product of a and b
+		// uses a single multiplication in a wider type for narrow UT,
+		// or 128-bit multiplication at runtime when available
+		template<typename UT>
+		constexpr double_word<UT> mul_wide(UT a, UT b)
+		{
+			if constexpr (!std::is_void_v<wider_unsigned_t<UT>>)
+			{
+				using WT = wider_unsigned_t<UT>;
+				const WT product = static_cast<WT>(static_cast<WT>(a) * static_cast<WT>(b));
+				return { static_cast<UT>(product >> std::numeric_limits<UT>::digits), static_cast<UT>(product) };
+			}
+			else if constexpr (has_intrinsic_u128<UT>)
+			{
+				if (!std::is_constant_evaluated())
+				{
+#if defined(__SIZEOF_INT128__)
+					const uint128 product = static_cast<uint128>(a) * b;
+					return { static_cast<UT>(product >> 64), static_cast<UT>(product) };
+#elif defined(_MSC_VER)
+					unsigned __int64 high;
+					const unsigned __int64 low = _umul128(a, b, &high);
+					return { high, low };
+#endif
+				}
+			}
+			return mul_wide_portable(a, b);
+		}
+		
+		// exact product of signed or unsigned a and b, as two's complement words
+		template<typename T>
+		constexpr double_word<std::make_unsigned_t<T>> mul_wide_signed(T a_signed, T b_signed)
+		{
+			using UT = std::make_unsigned_t<T>;
+			UT a = a_signed, b = b_signed;
+			UT negate = 0;
+			if constexpr (std::is_signed_v<T>)
+			{
+				const UT neg_a = sign_mask(a);
+				const UT neg_b = sign_mask(b);
+				a = negate_if(a, neg_a);
+				b = negate_if(b, neg_b);
+				negate = neg_a ^ neg_b;
+			}
+			const auto [high, low] = mul_wide(a, b);
+			// negate both words: ~high:~low + 1, where the carry only reaches high if low == 0
+			return { static_cast<UT>((high ^ negate) + (negate & UT(low == 0))), negate_if(low, negate) };
+		}
+		
+		// next wider integer type with the signedness of T, void if there is none
+		template<typename T>
+		using wider_t = std::conditional_t<std::is_void_v<wider_unsigned_t<std::make_unsigned_t<T>>>, void,
+			std::conditional_t<std::is_signed_v<T>, std::make_signed_t<wider_unsigned_t<std::make_unsigned_t<T>>>, wider_unsigned_t<std::make_unsigned_t<T>>>>;
+		
+		// divide the two word number (high, low) by b
+		// only the low word of the quotient is kept
+		// works for any unsigned UT, including custom types
+		template<typename UT>
+		constexpr div_result<UT> div_wide_portable(UT high, UT low, UT b)
+		{
+			constexpr auto bits_num = std::numeric_limits<UT>::digits;
+			// "Hardware Shift-and-Subtract Long Division" from Hacker's Delight
+			for (std::size_t i = 1; i <= bits_num; i++)
+			{
+				UT t = -(high >> (bits_num - 1)); // All 1’s if highest bit is set
+				// shift div left 1 bit
+				high = (high << 1) | (low >> (bits_num - 1));
+				low <<= 1;
+				if ((high | t) >= b)
+				{
+					high -= b;
+					low++;
+				}
+			}
+			return { low, high };
+		}
+		
+		// divide the two word number (high, low) by b
+		// uses a single division in a wider type for narrow UT
+		// uses 128-bit division at runtime when available and the quotient fits in one word,
+		// otherwise falls back to the portable algorithm so results never differ
+		template<typename UT>
+		constexpr div_result<UT> div_wide(UT high, UT low, UT b)
+		{
+			if constexpr (!std::is_void_v<wider_unsigned_t<UT>>)
+			{
+				using WT = wider_unsigned_t<UT>;
+				// same result as div_wide_portable instead of a division by zero
+				if (b == 0)
+				{
+					return { static_cast<UT>(~UT(0)), low };
+				}
+				const WT dividend = static_cast<WT>((static_cast<WT>(high) << std::numeric_limits<UT>::digits) | low);
+				return { static_cast<UT>(dividend / b), static_cast<UT>(dividend % b) };
+			}
+			else if constexpr (has_intrinsic_u128<UT>)
+			{
+				// also excludes b == 0
+				if (!std::is_constant_evaluated() && high < b)
+				{
+#if defined(__SIZEOF_INT128__) && defined(__x86_64__)
+					// a single divq, since the compiler cannot prove the quotient fits
+					// and would otherwise call the full 128/128 division routine
+					UT quotient, remainder;
+					__asm__("divq %[b]" : "=a"(quotient), "=d"(remainder) : [b] "rm"(b), "a"(low), "d"(high));
+					return { quotient, remainder };
+#elif defined(__SIZEOF_INT128__)
+					const uint128 dividend = (static_cast<uint128>(high) << 64) | low;
+					return { static_cast<UT>(dividend / b), static_cast<UT>(dividend % b) };
+#elif defined(_MSC_VER) && _MSC_VER >= 1920
+					unsigned __int64 remainder;
+					const unsigned __int64 quotient = _udiv128(high, low, b, &remainder);
+					return { quotient, remainder };
+#endif
+				}
+			}
+			return div_wide_portable(high, low, b);
+		}
+		
+		// mask of the fractional bits of raw_data, as an unsigned value
+		template<typename F>
+		constexpr auto fractional_mask()
+		{
+			using UT = std::make_unsigned_t<typename F::internal_type>;
+			if constexpr (F::fractional_bits >= std::numeric_limits<UT>::digits)
+			{
+				return static_cast<UT>(~UT(0));
+			}
+			else
+			{
+				return static_cast<UT>((UT(1) << F::fractional_bits) - 1);
+			}
+		}
 	}
 	
 	// simple fixed point type
@@ -52,6 +289,7 @@ namespace supsm
 		
 		public:
 		using internal_type = T;
+		static constexpr std::size_t fractional_bits = scale_bits;
 		
 		T raw_data = 0;
 		
@@ -73,13 +311,14 @@ namespace supsm
 			// should have no issues with T.
 			return T2(raw_data) >> scale_bits;
 		}
+		// the divisor is unsigned, since T(1) << scale_bits is negative when scale_bits is T's digits
 		constexpr explicit operator float() const
 		{
-			return float(raw_data) / (T(1) << scale_bits);
+			return float(raw_data) / (std::make_unsigned_t<T>(1) << scale_bits);
 		}
 		constexpr explicit operator double() const
 		{
-			return double(raw_data) / (T(1) << scale_bits);
+			return double(raw_data) / (std::make_unsigned_t<T>(1) << scale_bits);
 		}
 		
 		constexpr fixed operator+() const { fixed result; result.raw_data = +raw_data; return result; }
@@ -101,67 +340,37 @@ namespace supsm
 		constexpr fixed& operator-=(const fixed& other) { raw_data -= other.raw_data; return *this; }
 		// if fast_multdiv is false, uses half-size long multiplication
 		//   such that overflow only occurs if the result does not fit
+		//   (native 128-bit multiplication is used at runtime where available)
 		// otherwise multiplies `raw_data` members, which may cause overflow
 		constexpr fixed& operator*=(const fixed& other)
 		{
 			if constexpr (!fast_multdiv)
 			{
 				using UT = std::make_unsigned_t<T>;
-				// divide total bits by 2, rounding up
-				constexpr auto low_bits_num = std::numeric_limits<UT>::digits / 2;
 				constexpr auto bits_num = std::numeric_limits<UT>::digits;
-				auto high_bits = [low_bits_num](auto x) { return static_cast<UT>(x) >> low_bits_num; };
-				auto low_bits = [low_bits_num](auto x) { return static_cast<UT>(x) & ((UT(1) << low_bits_num) - 1); };
-		
+				
 				UT a = raw_data, b = other.raw_data;
-				bool negate;
+				UT negate = 0;
 				if constexpr (std::is_signed_v<T>)
 				{
 					// abs then restore sign at end
-					bool neg_a = a >> (bits_num - 1);
-					if (neg_a) { a = -a; }
-					bool neg_b = b >> (bits_num - 1);
-					if (neg_b) { b = -b; }
-					negate = neg_a != neg_b; // boolean xor
+					// branchless, since signs of real data are unpredictable
+					const UT neg_a = detail::sign_mask(a);
+					const UT neg_b = detail::sign_mask(b);
+					a = detail::negate_if(a, neg_a);
+					b = detail::negate_if(b, neg_b);
+					negate = neg_a ^ neg_b;
 				}
-		
-				// long multiplication
-				//       H1 L1
-				// x     H2 L2
-				// -----------
-				//        L1L2
-				//     H1L2  |
-				//     H2L1  |
-				//  H1H2  |  |
-				//  E1L2  |  |
-				//  L1E2  |  |
-				// R3 R2 R1 R0
-				const UT L1_L2 = low_bits(a) * low_bits(b);
-				// lowest bits of result
-				const UT result_0 = low_bits(L1_L2);
-				// keep H1L2 and L1H2 separate to prevent overflow
-				const UT H1_L2_C = high_bits(a) * low_bits(b) + high_bits(L1_L2);
-				// we only add low bits of H1_L2_C as a carry so no risk of overflow
-				const UT L1_H2_C = low_bits(a) * high_bits(b) + low_bits(H1_L2_C);
-				const UT result_1 = low_bits(L1_H2_C);
-				// very narrowly still guaranteed overflow-free
-				// (n-1)^2 + 2n = n^2-1
-				const UT H1_H2_C = high_bits(a) * high_bits(b) + high_bits(H1_L2_C) + high_bits(L1_H2_C);
-				UT result_2, result_3;
-				result_2 = low_bits(H1_H2_C);
-				result_3 = high_bits(H1_H2_C);
-		
-				UT result_low = result_0 | (result_1 << low_bits_num);
-				UT result_high = result_2 | (result_3 << low_bits_num);
-		
-				raw_data = static_cast<T>(((result_high & ((UT(1) << scale_bits) - 1)) << (bits_num - scale_bits)) | (result_low >> scale_bits));
-				if constexpr (std::is_signed_v<T>)
+				
+				const auto [result_high, result_low] = detail::mul_wide(a, b);
+				
+				UT result = result_low;
+				if constexpr (scale_bits != 0)
 				{
-					if (negate)
-					{
-						raw_data = -raw_data;
-					}
+					// shifting by bits_num would be undefined
+					result = ((result_high & ((UT(1) << scale_bits) - 1)) << (bits_num - scale_bits)) | (result_low >> scale_bits);
 				}
+				raw_data = static_cast<T>(detail::negate_if(result, negate));
 			}
 			else
 			{
@@ -177,46 +386,15 @@ namespace supsm
 			raw_data *= other;
 			return *this;
 		}
+		// if fast_multdiv is false, uses multiword division
+		//   such that overflow only occurs if the result does not fit
+		//   (native 128-bit division is used at runtime where available)
+		// otherwise shifts `raw_data` before dividing, which may cause overflow
 		constexpr fixed& operator/=(const fixed& other)
 		{
 			if constexpr (!fast_multdiv)
 			{
-				using UT = std::make_unsigned_t<T>;
-				constexpr auto bits_num = std::numeric_limits<UT>::digits;
-				UT a = raw_data, b = other.raw_data;
-				bool negate;
-				if constexpr (std::is_signed_v<T>)
-				{
-					// abs then restore sign at end
-					bool neg_a = a >> (bits_num - 1);
-					if (neg_a) { a = -a; }
-					bool neg_b = b >> (bits_num - 1);
-					if (neg_b) { b = -b; }
-					negate = neg_a != neg_b; // boolean xor
-				}
-				UT div_high = (scale_bits == 0 ? 0 : a >> (bits_num - scale_bits));
-				UT div_low = a << scale_bits;
-				// "Hardware Shift-and-Subtract Long Division" from Hacker's Delight
-				for (std::size_t i = 1; i <= bits_num; i++)
-				{
-					UT t = -(div_high >> (bits_num - 1)); // All 1’s if highest bit is set
-					// shift div left 1 bit
-					div_high = (div_high << 1) | (div_low >> (bits_num - 1));
-					div_low <<= 1;
-					if ((div_high | t) >= b)
-					{
-						div_high -= b;
-						div_low++;
-					}
-				}
-				if constexpr (std::is_signed_v<T>)
-				{
-					if (negate)
-					{
-						div_low = -div_low;
-					}
-				}
-				raw_data = static_cast<T>(div_low);
+				raw_data = shifted_quotient<scale_bits>(raw_data, other.raw_data);
 			}
 			else
 			{
@@ -249,7 +427,21 @@ namespace supsm
 		// multiplication is commutative and can be simplified
 		// easily for integers, unlike division and modulus
 		constexpr friend fixed operator*(detail::integer_or_T<T> auto left, const fixed& right) { fixed result = right; result.raw_data *= left; return result; }
-		constexpr friend fixed operator/(detail::integer_or_T<T> auto left, const fixed& right) { return fixed(left) / right; }
+		// integer / fixed is (left << 2 * scale_bits) / right.raw_data, a single wide division
+		// rather than converting left to fixed first (which can overflow) and dividing
+		constexpr friend fixed operator/(detail::integer_or_T<T> auto left, const fixed& right)
+		{
+			fixed result;
+			if constexpr (!fast_multdiv)
+			{
+				result.raw_data = shifted_quotient<2 * scale_bits>(T(left), right.raw_data);
+			}
+			else
+			{
+				result.raw_data = (static_cast<multdiv_cast_type>(left) << (2 * scale_bits)) / static_cast<multdiv_cast_type>(right.raw_data);
+			}
+			return result;
+		}
 		constexpr friend fixed operator%(detail::integer_or_T<T> auto left, const fixed& right) { return fixed(left) % right; }
 		
 		constexpr friend fixed operator&(detail::integer_or_T<T> auto left, const fixed& right) { return fixed(left) & right; }
@@ -258,7 +450,406 @@ namespace supsm
 		
 		constexpr std::strong_ordering operator<=>(const fixed& other) const { return raw_data <=> other.raw_data; }
 		constexpr bool operator==(const fixed& other) const = default;
+		
+		// comparisons with integers are exact for every value of I, without converting
+		// the integer to fixed (which can overflow): the integer part of this (floor) is
+		// compared first, and only if equal does the fractional part decide
+		template<detail::comparable_integer I> requires detail::comparable_integer<T>
+		constexpr std::strong_ordering operator<=>(I other) const
+		{
+			const T whole = integer_part();
+			if (!std::cmp_equal(whole, other))
+			{
+				return std::cmp_less(whole, other) ? std::strong_ordering::less : std::strong_ordering::greater;
+			}
+			return (static_cast<std::make_unsigned_t<T>>(raw_data) & detail::fractional_mask<fixed>()) != 0 ? std::strong_ordering::greater : std::strong_ordering::equal;
+		}
+		template<detail::comparable_integer I> requires detail::comparable_integer<T>
+		constexpr bool operator==(I other) const
+		{
+			return std::cmp_equal(integer_part(), other) && (static_cast<std::make_unsigned_t<T>>(raw_data) & detail::fractional_mask<fixed>()) == 0;
+		}
+		
+		private:
+		// (a << shift) / b, with the shifted dividend in two words so it cannot overflow
+		// only overflows if the quotient cannot be represented using T
+		template<std::size_t shift>
+		static constexpr T shifted_quotient(T a_signed, T b_signed)
+		{
+			using UT = std::make_unsigned_t<T>;
+			constexpr auto bits_num = std::numeric_limits<UT>::digits;
+			static_assert(shift < 2 * bits_num);
+			UT a = a_signed, b = b_signed;
+			UT negate = 0;
+			if constexpr (std::is_signed_v<T>)
+			{
+				// abs then restore sign at end
+				// branchless, since signs of real data are unpredictable
+				const UT neg_a = detail::sign_mask(a);
+				const UT neg_b = detail::sign_mask(b);
+				a = detail::negate_if(a, neg_a);
+				b = detail::negate_if(b, neg_b);
+				negate = neg_a ^ neg_b;
+			}
+			UT div_high, div_low;
+			if constexpr (shift == 0)
+			{
+				div_high = 0;
+				div_low = a;
+			}
+			else if constexpr (shift < bits_num)
+			{
+				div_high = a >> (bits_num - shift);
+				div_low = a << shift;
+			}
+			else
+			{
+				div_high = a << (shift - bits_num);
+				div_low = 0;
+			}
+			const UT quotient = detail::div_wide(div_high, div_low, b).quotient;
+			return static_cast<T>(detail::negate_if(quotient, negate));
+		}
+		
+		static constexpr bool all_fractional = scale_bits >= std::numeric_limits<T>::digits + std::numeric_limits<T>::is_signed;
+		// floor of the value
+		constexpr T integer_part() const
+		{
+			if constexpr (all_fractional)
+			{
+				return raw_data < 0 ? static_cast<T>(-1) : T(0);
+			}
+			else
+			{
+				return static_cast<T>(raw_data >> scale_bits);
+			}
+		}
 	};
+	
+	// convert between fixed point types with different T or scale_bits
+	// fractional bits that do not fit are truncated (towards negative infinity),
+	// and overflow behavior follows the wider of the two underlying types
+	template<typename To, typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr To fixed_cast(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& value)
+	{
+		using T2 = typename To::internal_type;
+		constexpr std::size_t to_bits = To::fractional_bits;
+		To result;
+		if constexpr (to_bits >= scale_bits)
+		{
+			// shift in the wider type
+			if constexpr (std::numeric_limits<T2>::digits >= std::numeric_limits<T>::digits)
+			{
+				result.raw_data = static_cast<T2>(static_cast<T2>(value.raw_data) << (to_bits - scale_bits));
+			}
+			else
+			{
+				result.raw_data = static_cast<T2>(value.raw_data << (to_bits - scale_bits));
+			}
+		}
+		else
+		{
+			result.raw_data = static_cast<T2>(value.raw_data >> (scale_bits - to_bits));
+		}
+		return result;
+	}
+	
+	namespace detail
+	{
+		template<typename F, typename UT>
+		constexpr F from_raw_bits(UT bits)
+		{
+			F result;
+			result.raw_data = static_cast<typename F::internal_type>(bits);
+			return result;
+		}
+	}
+	
+	// rounding functions, with the same semantics as the <cmath> functions of the same name
+	// each clears the fractional bits of raw_data, after adding an offset where needed
+	// (results that do not fit overflow like T)
+	
+	// largest integer not greater than x
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr fixed<T, scale_bits, fast_multdiv, multdiv_cast_type> floor(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& x)
+	{
+		using F = fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>;
+		using UT = std::make_unsigned_t<T>;
+		// two's complement makes masking round towards negative infinity
+		return detail::from_raw_bits<F>(static_cast<UT>(x.raw_data) & static_cast<UT>(~detail::fractional_mask<F>()));
+	}
+	// smallest integer not less than x
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr fixed<T, scale_bits, fast_multdiv, multdiv_cast_type> ceil(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& x)
+	{
+		using F = fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>;
+		using UT = std::make_unsigned_t<T>;
+		constexpr UT mask = detail::fractional_mask<F>();
+		return detail::from_raw_bits<F>(static_cast<UT>(static_cast<UT>(x.raw_data) + mask) & static_cast<UT>(~mask));
+	}
+	// x rounded towards zero
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr fixed<T, scale_bits, fast_multdiv, multdiv_cast_type> trunc(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& x)
+	{
+		using F = fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>;
+		using UT = std::make_unsigned_t<T>;
+		constexpr UT mask = detail::fractional_mask<F>();
+		const UT bits = static_cast<UT>(x.raw_data);
+		if constexpr (std::is_signed_v<T>)
+		{
+			// ceil for negative values, floor otherwise
+			return detail::from_raw_bits<F>(static_cast<UT>(bits + (mask & detail::sign_mask(bits))) & static_cast<UT>(~mask));
+		}
+		else
+		{
+			return detail::from_raw_bits<F>(bits & static_cast<UT>(~mask));
+		}
+	}
+	// x rounded to the nearest integer, with halfway cases away from zero
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr fixed<T, scale_bits, fast_multdiv, multdiv_cast_type> round(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& x)
+	{
+		using F = fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>;
+		using UT = std::make_unsigned_t<T>;
+		if constexpr (scale_bits == 0)
+		{
+			return x;
+		}
+		else
+		{
+			constexpr UT mask = detail::fractional_mask<F>();
+			constexpr UT half = static_cast<UT>((mask >> 1) + 1);
+			const UT bits = static_cast<UT>(x.raw_data);
+			// floor(x + 0.5), except negative halfway cases must go down: floor(x + 0.5 - ulp)
+			UT offset = half;
+			if constexpr (std::is_signed_v<T>)
+			{
+				offset += detail::sign_mask(bits);
+			}
+			return detail::from_raw_bits<F>(static_cast<UT>(bits + offset) & static_cast<UT>(~mask));
+		}
+	}
+	// x - floor(x), in [0, 1)
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr fixed<T, scale_bits, fast_multdiv, multdiv_cast_type> frac(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& x)
+	{
+		using F = fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>;
+		using UT = std::make_unsigned_t<T>;
+		return detail::from_raw_bits<F>(static_cast<UT>(x.raw_data) & detail::fractional_mask<F>());
+	}
+	// split x into integer part (stored to *integral) and fractional part (returned),
+	// both rounded towards zero and with the sign of x
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr fixed<T, scale_bits, fast_multdiv, multdiv_cast_type> modf(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& x, fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>* integral)
+	{
+		*integral = trunc(x);
+		return x - *integral;
+	}
+	// remainder of x / y with the quotient rounded towards zero, which has the sign of x
+	// this is exact, and is the same as operator%
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr fixed<T, scale_bits, fast_multdiv, multdiv_cast_type> fmod(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& x, const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& y)
+	{
+		// both have the same scale, so this is the integer remainder of raw_data
+		fixed<T, scale_bits, fast_multdiv, multdiv_cast_type> result;
+		result.raw_data = static_cast<T>(x.raw_data % y.raw_data);
+		return result;
+	}
+	
+	// exact product of a and b in the next wider type, with twice the scale_bits, so nothing is truncated
+	// e.g. for accumulating many products before rounding once
+	// only for underlying types of up to 32 bits; use mul_high and mul_low for wider types
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+		requires (!std::is_void_v<detail::wider_t<T>>)
+	constexpr fixed<detail::wider_t<T>, 2 * scale_bits> mul_wide(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& a, const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& b)
+	{
+		using W = detail::wider_t<T>;
+		fixed<W, 2 * scale_bits> result;
+		result.raw_data = static_cast<W>(static_cast<W>(a.raw_data) * static_cast<W>(b.raw_data));
+		return result;
+	}
+	// the exact product of raw_data is mul_high(a, b) * 2^bits + mul_low(a, b), with 2 * scale_bits fractional bits,
+	// where bits is the width of T (two's complement, so the high word carries the sign)
+	// operator* keeps the middle bits of this product
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr T mul_high(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& a, const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& b)
+	{
+		return static_cast<T>(detail::mul_wide_signed(a.raw_data, b.raw_data).high);
+	}
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr std::make_unsigned_t<T> mul_low(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& a, const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& b)
+	{
+		// the low word does not depend on signedness
+		return static_cast<std::make_unsigned_t<T>>(static_cast<std::make_unsigned_t<T>>(a.raw_data) * static_cast<std::make_unsigned_t<T>>(b.raw_data));
+	}
+	
+	// a * b * c * ... with a single rescale: the exact product of all raw_data is formed in
+	// multiple words and shifted right by (N - 1) * scale_bits once, so there is one truncation
+	// (towards zero, like operator*) instead of one per multiplication
+	// only overflows if the final result cannot be represented using T
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type, std::same_as<fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>>... Rest>
+	constexpr fixed<T, scale_bits, fast_multdiv, multdiv_cast_type> product(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& first, const Rest&... rest)
+	{
+		using F = fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>;
+		using UT = std::make_unsigned_t<T>;
+		constexpr std::size_t n = 1 + sizeof...(Rest);
+		constexpr std::size_t bits_num = std::numeric_limits<UT>::digits;
+		constexpr std::size_t shift = (n - 1) * scale_bits;
+		
+		UT negate = 0;
+		const auto magnitude = [&negate](const F& x)
+		{
+			UT value = static_cast<UT>(x.raw_data);
+			if constexpr (std::is_signed_v<T>)
+			{
+				const UT neg = detail::sign_mask(value);
+				negate ^= neg;
+				value = detail::negate_if(value, neg);
+			}
+			return value;
+		};
+		
+		UT result;
+		if constexpr (n * bits_num <= 64)
+		{
+			// the whole product fits in one native word
+			std::uint64_t full = magnitude(first);
+			((full *= magnitude(rest)), ...);
+			result = static_cast<UT>(full >> shift);
+		}
+		else
+		{
+			// little endian words of the product so far
+			UT words[n] = { magnitude(first) };
+			std::size_t used = 1;
+			const auto multiply = [&words, &used](UT factor)
+			{
+				UT carry = 0;
+				for (std::size_t i = 0; i < used; i++)
+				{
+					auto [high, low] = detail::mul_wide(words[i], factor);
+					low += carry;
+					high += UT(low < carry);
+					words[i] = low;
+					carry = high;
+				}
+				words[used++] = carry;
+			};
+			(multiply(magnitude(rest)), ...);
+			constexpr std::size_t word = shift / bits_num, bit = shift % bits_num;
+			result = words[word] >> bit;
+			if constexpr (bit != 0 && word + 1 < n)
+			{
+				result |= static_cast<UT>(words[word + 1] << (bits_num - bit));
+			}
+		}
+		return detail::from_raw_bits<F>(detail::negate_if(result, negate));
+	}
+	
+	template<typename F>
+	struct divmod_result
+	{
+		typename F::internal_type quotient;
+		F remainder;
+	};
+	// whole number of times y fits in x (rounded towards zero) and the remainder,
+	// so that x == quotient * y + remainder, like std::div
+	// both come from one integer division of raw_data
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr divmod_result<fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>> divmod(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& x, const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& y)
+	{
+		divmod_result<fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>> result;
+		// compilers emit a single division instruction for both
+		result.quotient = static_cast<T>(x.raw_data / y.raw_data);
+		result.remainder.raw_data = static_cast<T>(x.raw_data % y.raw_data);
+		return result;
+	}
+	
+	// branch-free helpers, operating on raw_data with masks instead of comparisons and jumps
+	
+	// |x|, which overflows like T for min()
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr fixed<T, scale_bits, fast_multdiv, multdiv_cast_type> abs(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& x)
+	{
+		using F = fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>;
+		using UT = std::make_unsigned_t<T>;
+		if constexpr (std::is_signed_v<T>)
+		{
+			const UT bits = static_cast<UT>(x.raw_data);
+			return detail::from_raw_bits<F>(detail::negate_if(bits, detail::sign_mask(bits)));
+		}
+		else
+		{
+			return x;
+		}
+	}
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr fixed<T, scale_bits, fast_multdiv, multdiv_cast_type> min(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& a, const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& b)
+	{
+		using F = fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>;
+		using UT = std::make_unsigned_t<T>;
+		// select b where b < a
+		const UT select = static_cast<UT>(-static_cast<UT>(b.raw_data < a.raw_data));
+		return detail::from_raw_bits<F>(static_cast<UT>(a.raw_data) ^ ((static_cast<UT>(a.raw_data) ^ static_cast<UT>(b.raw_data)) & select));
+	}
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr fixed<T, scale_bits, fast_multdiv, multdiv_cast_type> max(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& a, const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& b)
+	{
+		using F = fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>;
+		using UT = std::make_unsigned_t<T>;
+		// select b where a < b
+		const UT select = static_cast<UT>(-static_cast<UT>(a.raw_data < b.raw_data));
+		return detail::from_raw_bits<F>(static_cast<UT>(a.raw_data) ^ ((static_cast<UT>(a.raw_data) ^ static_cast<UT>(b.raw_data)) & select));
+	}
+	// x limited to [lo, hi], with lo <= hi
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr fixed<T, scale_bits, fast_multdiv, multdiv_cast_type> clamp(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& x, const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& lo, const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& hi)
+	{
+		return max(lo, min(x, hi));
+	}
+	// |magnitude| with the sign of sign (a sign bit, so 0 counts as positive)
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr fixed<T, scale_bits, fast_multdiv, multdiv_cast_type> copysign(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& magnitude, const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& sign)
+	{
+		using F = fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>;
+		using UT = std::make_unsigned_t<T>;
+		if constexpr (std::is_signed_v<T>)
+		{
+			const UT bits = static_cast<UT>(abs(magnitude).raw_data);
+			return detail::from_raw_bits<F>(detail::negate_if(bits, detail::sign_mask(static_cast<UT>(sign.raw_data))));
+		}
+		else
+		{
+			return magnitude;
+		}
+	}
+	// -1, 0 or 1 as an int, since 1 may not be representable in the fixed type
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr int signum(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& x)
+	{
+		return int(x.raw_data > 0) - int(x.raw_data < 0);
+	}
+	
+	// 1 / x, computed as 2^(2 * scale_bits) / x.raw_data with one wide division
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	constexpr fixed<T, scale_bits, fast_multdiv, multdiv_cast_type> reciprocal(const fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& x)
+	{
+		return 1 / x;
+	}
+	
+	namespace detail
+	{
+		// 64-bit finalizer of splitmix64, every input bit affects every output bit
+		constexpr std::uint64_t hash_mix(std::uint64_t x)
+		{
+			x ^= x >> 30;
+			x *= 0xbf58476d1ce4e5b9u;
+			x ^= x >> 27;
+			x *= 0x94d049bb133111ebu;
+			x ^= x >> 31;
+			return x;
+		}
+	}
 }
 
 namespace std
@@ -295,4 +886,16 @@ namespace std
 		static constexpr fixed_type epsilon() { return fixed_type(1, scale_bits); }
 		static constexpr fixed_type round_error() { return 1; }
 	};
+	
+	// hashes raw_data, so equal values have equal hashes
+	// raw_data is mixed because the low bits of fixed point values are often all 0
+	// (e.g. prices with few decimals), which is a poor distribution for hash tables
+	template<std::integral T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	struct hash<::supsm::fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>>
+	{
+		constexpr std::size_t operator()(const ::supsm::fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>& x) const noexcept
+		{
+			return static_cast<std::size_t>(::supsm::detail::hash_mix(static_cast<std::uint64_t>(x.raw_data)));
+		}
+	};
 }
@@ -0,0 +1,124 @@
+/*
+MIT License
+
+Copyright (c) 2024 supsm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <span>
+
+// size in bytes of each thread's arena, see supsm::thread_arena
+#ifndef SUPSM_FIXED_THREAD_ARENA_SIZE
+#define SUPSM_FIXED_THREAD_ARENA_SIZE (std::size_t(1) << 20)
+#endif
+
+namespace supsm
+{
+	// monotonic memory resource over a single buffer, for scratch space
+	// (e.g. temporary fixed_vector or std::pmr::vector<fixed>) in real-time loops
+	// - allocation bumps a pointer and never calls upstream allocation
+	// - deallocation does nothing; memory is reclaimed by reset() or rewind()
+	// - throws std::bad_alloc when the buffer is exhausted
+	// not thread safe, use one arena per thread (see thread_arena)
+	class fixed_arena : public std::pmr::memory_resource
+	{
+		public:
+		// use an existing buffer, which must outlive the arena
+		explicit fixed_arena(std::span<std::byte> buffer) : buffer(buffer) {}
+		// allocate a buffer of `size` bytes once, from `upstream`
+		explicit fixed_arena(std::size_t size, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) :
+			buffer(static_cast<std::byte*>(upstream->allocate(size, alignof(std::max_align_t))), size), upstream(upstream) {}
+		fixed_arena(const fixed_arena&) = delete;
+		fixed_arena& operator=(const fixed_arena&) = delete;
+		~fixed_arena()
+		{
+			if (upstream != nullptr)
+			{
+				upstream->deallocate(buffer.data(), buffer.size(), alignof(std::max_align_t));
+			}
+		}
+		
+		// free everything, e.g. at the end of a frame
+		void reset() { offset = 0; }
+		// current position, to be passed to rewind()
+		std::size_t mark() const { return offset; }
+		// free everything allocated since `position` was obtained from mark()
+		void rewind(std::size_t position) { offset = position; }
+		
+		std::size_t used() const { return offset; }
+		std::size_t capacity() const { return buffer.size(); }
+		// largest amount ever used, for sizing the buffer
+		std::size_t high_water() const { return peak; }
+		
+		private:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(buffer.data());
+			// alignment is always a power of 2
+			const std::size_t start = ((base + offset + alignment - 1) & ~(std::uintptr_t(alignment) - 1)) - base;
+			if (start + bytes > buffer.size() || start < offset)
+			{
+				throw std::bad_alloc();
+			}
+			offset = start + bytes;
+			if (offset > peak)
+			{
+				peak = offset;
+			}
+			return buffer.data() + start;
+		}
+		void do_deallocate(void*, std::size_t, std::size_t) override {}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+		
+		std::span<std::byte> buffer;
+		std::pmr::memory_resource* upstream = nullptr;
+		std::size_t offset = 0;
+		std::size_t peak = 0;
+	};
+	
+	// arena owned by the calling thread, of SUPSM_FIXED_THREAD_ARENA_SIZE bytes
+	// its buffer is allocated on the first call from each thread, so call it
+	// once during setup to keep allocation out of the real-time loop
+	inline fixed_arena& thread_arena()
+	{
+		thread_local fixed_arena arena(SUPSM_FIXED_THREAD_ARENA_SIZE);
+		return arena;
+	}
+	
+	// rewinds an arena to its position at construction when going out of scope
+	// scopes may be nested, e.g. one per frame and one per kernel
+	class arena_scope
+	{
+		public:
+		explicit arena_scope(fixed_arena& arena = thread_arena()) : arena(arena), position(arena.mark()) {}
+		arena_scope(const arena_scope&) = delete;
+		arena_scope& operator=(const arena_scope&) = delete;
+		~arena_scope() { arena.rewind(position); }
+		
+		private:
+		fixed_arena& arena;
+		std::size_t position;
+	};
+}
@@ -0,0 +1,128 @@
+/*
+MIT License
+
+Copyright (c) 2024 supsm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "fixed.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace supsm
+{
+	// sums any number of input streams with per-channel gains and a master gain
+	// - the master gain is folded into each channel's gain when either changes,
+	//   so mixing costs one multiply-accumulate per input sample
+	// - products are accumulated exactly in 64 bits, then rounded and saturated once per output sample
+	// - processing is block-wise, channel by channel, so the inner loops run over
+	//   contiguous samples and are auto-vectorized
+	// accumulation is exact as long as the sum of |sample * gain| stays below 2^63 raw,
+	// e.g. for 256 channels of 32 bit samples with gains below 16
+	// @tparam F  sample type, e.g. fixed<int16_t, 15> or fixed<int32_t, 15>
+	template<typename F>
+	class mixer
+	{
+		using raw_type = typename F::internal_type;
+		static_assert(std::is_signed_v<raw_type> && std::numeric_limits<raw_type>::digits <= 31);
+		
+		public:
+		using sample_type = F;
+		using gain_type = fixed<std::int32_t, 16>;
+		
+		// all gains are 1
+		explicit mixer(std::size_t channels) : channel_gains(channels, gain_type(1)), effective_gains(channels, std::int64_t(1) << 16) {}
+		
+		std::size_t channels() const { return channel_gains.size(); }
+		gain_type gain(std::size_t channel) const { return channel_gains[channel]; }
+		gain_type master_gain() const { return master; }
+		
+		void set_gain(std::size_t channel, gain_type gain)
+		{
+			channel_gains[channel] = gain;
+			effective_gains[channel] = combine(gain);
+		}
+		void set_master_gain(gain_type gain)
+		{
+			master = gain;
+			for (std::size_t c = 0; c < channels(); c++)
+			{
+				effective_gains[c] = combine(channel_gains[c]);
+			}
+		}
+		
+		// output[i] = saturate(master * sum_c gain[c] * inputs[c][i])
+		// every input must have at least output.size() samples; channels with gain 0 are skipped,
+		// as are inputs beyond channels()
+		// the accumulator only allocates when a larger block than before is processed
+		void process(std::span<const std::span<const F>> inputs, std::span<F> output)
+		{
+			const std::size_t n = output.size();
+			if (accumulator.size() < n)
+			{
+				accumulator.resize(n);
+			}
+			std::int64_t* acc = accumulator.data();
+			std::fill_n(acc, n, std::int64_t(0));
+			const std::size_t streams = std::min(inputs.size(), channels());
+			for (std::size_t c = 0; c < streams; c++)
+			{
+				const std::int64_t gain = effective_gains[c];
+				if (gain == 0)
+				{
+					continue;
+				}
+				const F* in = inputs[c].data();
+				for (std::size_t i = 0; i < n; i++)
+				{
+					acc[i] += in[i].raw_data * gain;
+				}
+			}
+			// gains have 16 fractional bits
+			constexpr std::int64_t half = std::int64_t(1) << 15;
+			constexpr std::int64_t lo = std::numeric_limits<raw_type>::min(), hi = std::numeric_limits<raw_type>::max();
+			for (std::size_t i = 0; i < n; i++)
+			{
+				output[i].raw_data = static_cast<raw_type>(std::clamp((acc[i] + half) >> 16, lo, hi));
+			}
+		}
+		
+		private:
+		// channel gain * master gain, rounded to 16 fractional bits
+		// kept in 64 bits, since the product of two gain_type values can exceed gain_type
+		std::int64_t combine(gain_type gain) const
+		{
+			const std::int64_t product = std::int64_t(gain.raw_data) * master.raw_data;
+			return (product + (std::int64_t(1) << 15)) >> 16;
+		}
+		
+		std::vector<gain_type> channel_gains;
+		gain_type master = 1;
+		std::vector<std::int64_t> effective_gains;
+		std::vector<std::int64_t> accumulator;
+	};
+}
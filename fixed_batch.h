@@ -0,0 +1,279 @@
+/*
+MIT License
+
+Copyright (c) 2024 supsm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "fixed.h"
+
+#include <cstddef>
+#include <ranges>
+
+// element-wise kernels over contiguous ranges of fixed
+// all kernels are simple loops over raw_data (or the scalar operators) without
+// branches or aliasing through other types, so they are auto-vectorized by the compiler
+// inputs must have at least as many elements as `out`; `out` may alias an input
+namespace supsm
+{
+	template<typename T>
+	struct is_fixed : std::false_type {};
+	template<typename T, std::size_t scale_bits, bool fast_multdiv, typename multdiv_cast_type>
+	struct is_fixed<fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>> : std::true_type {};
+	template<typename T>
+	constexpr bool is_fixed_v = is_fixed<T>::value;
+	
+	// contiguous range of fixed, e.g. std::vector<fixed>, std::span<fixed> or fixed_vector
+	template<typename R>
+	concept fixed_range = std::ranges::contiguous_range<R> && std::ranges::sized_range<R> && is_fixed_v<std::ranges::range_value_t<R>>;
+	
+	namespace detail
+	{
+		// apply fn(out[i], a[i]) for every element of out
+		template<fixed_range Out, fixed_range A>
+		constexpr void transform_batch(Out&& out, const A& a, auto fn)
+		{
+			auto* o = std::ranges::data(out);
+			const auto* x = std::ranges::data(a);
+			const std::size_t n = std::ranges::size(out);
+			for (std::size_t i = 0; i < n; i++)
+			{
+				fn(o[i], x[i]);
+			}
+		}
+		// apply fn(out[i], a[i], b[i]) for every element of out
+		template<fixed_range Out, fixed_range A, fixed_range B>
+		constexpr void transform_batch(Out&& out, const A& a, const B& b, auto fn)
+		{
+			auto* o = std::ranges::data(out);
+			const auto* x = std::ranges::data(a);
+			const auto* y = std::ranges::data(b);
+			const std::size_t n = std::ranges::size(out);
+			for (std::size_t i = 0; i < n; i++)
+			{
+				fn(o[i], x[i], y[i]);
+			}
+		}
+	}
+	
+	// out[i] = a[i] + b[i]
+	template<fixed_range A, fixed_range B, fixed_range Out>
+	constexpr void add(const A& a, const B& b, Out&& out)
+	{
+		detail::transform_batch(out, a, b, [](auto& o, auto x, auto y) { o.raw_data = x.raw_data + y.raw_data; });
+	}
+	// out[i] = a[i] + b
+	template<fixed_range A, fixed_range Out>
+	constexpr void add(const A& a, std::ranges::range_value_t<A> b, Out&& out)
+	{
+		detail::transform_batch(out, a, [b](auto& o, auto x) { o.raw_data = x.raw_data + b.raw_data; });
+	}
+	// out[i] = a[i] - b[i]
+	template<fixed_range A, fixed_range B, fixed_range Out>
+	constexpr void sub(const A& a, const B& b, Out&& out)
+	{
+		detail::transform_batch(out, a, b, [](auto& o, auto x, auto y) { o.raw_data = x.raw_data - y.raw_data; });
+	}
+	// out[i] = a[i] - b
+	template<fixed_range A, fixed_range Out>
+	constexpr void sub(const A& a, std::ranges::range_value_t<A> b, Out&& out)
+	{
+		detail::transform_batch(out, a, [b](auto& o, auto x) { o.raw_data = x.raw_data - b.raw_data; });
+	}
+	// out[i] = a[i] * b[i]
+	template<fixed_range A, fixed_range B, fixed_range Out>
+	constexpr void mul(const A& a, const B& b, Out&& out)
+	{
+		detail::transform_batch(out, a, b, [](auto& o, auto x, auto y) { o = x * y; });
+	}
+	// out[i] = a[i] * b
+	template<fixed_range A, fixed_range Out>
+	constexpr void mul(const A& a, std::ranges::range_value_t<A> b, Out&& out)
+	{
+		detail::transform_batch(out, a, [b](auto& o, auto x) { o = x * b; });
+	}
+	// out[i] = a[i] / b[i]
+	template<fixed_range A, fixed_range B, fixed_range Out>
+	constexpr void div(const A& a, const B& b, Out&& out)
+	{
+		detail::transform_batch(out, a, b, [](auto& o, auto x, auto y) { o = x / y; });
+	}
+	// out[i] = a[i] / b
+	template<fixed_range A, fixed_range Out>
+	constexpr void div(const A& a, std::ranges::range_value_t<A> b, Out&& out)
+	{
+		detail::transform_batch(out, a, [b](auto& o, auto x) { o = x / b; });
+	}
+	// out[i] = product(a[i], b[i], c[i]), rescaling once per element
+	template<fixed_range A, fixed_range B, fixed_range C, fixed_range Out>
+	constexpr void product(const A& a, const B& b, const C& c, Out&& out)
+	{
+		const auto* z = std::ranges::data(c);
+		detail::transform_batch(out, a, b, [&z](auto& o, auto x, auto y) { o = product(x, y, *z++); });
+	}
+	// out[i] = 1 / a[i]
+	template<fixed_range A, fixed_range Out>
+	constexpr void reciprocal(const A& a, Out&& out)
+	{
+		detail::transform_batch(out, a, [](auto& o, auto x) { o = reciprocal(x); });
+	}
+	
+	// out[i] = floor(a[i])
+	template<fixed_range A, fixed_range Out>
+	constexpr void floor(const A& a, Out&& out)
+	{
+		detail::transform_batch(out, a, [](auto& o, auto x) { o = floor(x); });
+	}
+	// out[i] = ceil(a[i])
+	template<fixed_range A, fixed_range Out>
+	constexpr void ceil(const A& a, Out&& out)
+	{
+		detail::transform_batch(out, a, [](auto& o, auto x) { o = ceil(x); });
+	}
+	// out[i] = trunc(a[i])
+	template<fixed_range A, fixed_range Out>
+	constexpr void trunc(const A& a, Out&& out)
+	{
+		detail::transform_batch(out, a, [](auto& o, auto x) { o = trunc(x); });
+	}
+	// out[i] = round(a[i])
+	template<fixed_range A, fixed_range Out>
+	constexpr void round(const A& a, Out&& out)
+	{
+		detail::transform_batch(out, a, [](auto& o, auto x) { o = round(x); });
+	}
+	// out[i] = frac(a[i])
+	template<fixed_range A, fixed_range Out>
+	constexpr void frac(const A& a, Out&& out)
+	{
+		detail::transform_batch(out, a, [](auto& o, auto x) { o = frac(x); });
+	}
+	// integral[i] = trunc(a[i]), fractional[i] = a[i] - integral[i]
+	template<fixed_range A, fixed_range Out1, fixed_range Out2>
+	constexpr void modf(const A& a, Out1&& integral, Out2&& fractional)
+	{
+		auto* in = std::ranges::data(integral);
+		detail::transform_batch(fractional, a, [&in](auto& o, auto x) { o = modf(x, in++); });
+	}
+	// out[i] = fmod(a[i], b[i])
+	template<fixed_range A, fixed_range B, fixed_range Out>
+	constexpr void fmod(const A& a, const B& b, Out&& out)
+	{
+		detail::transform_batch(out, a, b, [](auto& o, auto x, auto y) { o = fmod(x, y); });
+	}
+	// out[i] = fmod(a[i], b)
+	template<fixed_range A, fixed_range Out>
+	constexpr void fmod(const A& a, std::ranges::range_value_t<A> b, Out&& out)
+	{
+		detail::transform_batch(out, a, [b](auto& o, auto x) { o = fmod(x, b); });
+	}
+	// quotients[i], remainders[i] = divmod(a[i], b[i]), with `quotients` a contiguous range of internal_type
+	template<fixed_range A, fixed_range B, std::ranges::contiguous_range Quot, fixed_range Rem>
+	constexpr void divmod(const A& a, const B& b, Quot&& quotients, Rem&& remainders)
+	{
+		auto* q = std::ranges::data(quotients);
+		const auto* y = std::ranges::data(b);
+		detail::transform_batch(remainders, a, [&q, &y](auto& r, auto x)
+		{
+			const auto result = divmod(x, *y++);
+			*q++ = result.quotient;
+			r = result.remainder;
+		});
+	}
+	// quotients[i], remainders[i] = divmod(a[i], b)
+	template<fixed_range A, std::ranges::contiguous_range Quot, fixed_range Rem>
+	constexpr void divmod(const A& a, std::ranges::range_value_t<A> b, Quot&& quotients, Rem&& remainders)
+	{
+		auto* q = std::ranges::data(quotients);
+		detail::transform_batch(remainders, a, [&q, b](auto& r, auto x)
+		{
+			const auto result = divmod(x, b);
+			*q++ = result.quotient;
+			r = result.remainder;
+		});
+	}
+	
+	// out[i] = abs(a[i])
+	template<fixed_range A, fixed_range Out>
+	constexpr void abs(const A& a, Out&& out)
+	{
+		detail::transform_batch(out, a, [](auto& o, auto x) { o = abs(x); });
+	}
+	// out[i] = min(a[i], b[i])
+	template<fixed_range A, fixed_range B, fixed_range Out>
+	constexpr void min(const A& a, const B& b, Out&& out)
+	{
+		detail::transform_batch(out, a, b, [](auto& o, auto x, auto y) { o = min(x, y); });
+	}
+	// out[i] = min(a[i], b)
+	template<fixed_range A, fixed_range Out>
+	constexpr void min(const A& a, std::ranges::range_value_t<A> b, Out&& out)
+	{
+		detail::transform_batch(out, a, [b](auto& o, auto x) { o = min(x, b); });
+	}
+	// out[i] = max(a[i], b[i])
+	template<fixed_range A, fixed_range B, fixed_range Out>
+	constexpr void max(const A& a, const B& b, Out&& out)
+	{
+		detail::transform_batch(out, a, b, [](auto& o, auto x, auto y) { o = max(x, y); });
+	}
+	// out[i] = max(a[i], b)
+	template<fixed_range A, fixed_range Out>
+	constexpr void max(const A& a, std::ranges::range_value_t<A> b, Out&& out)
+	{
+		detail::transform_batch(out, a, [b](auto& o, auto x) { o = max(x, b); });
+	}
+	// out[i] = clamp(a[i], lo, hi)
+	template<fixed_range A, fixed_range Out>
+	constexpr void clamp(const A& a, std::ranges::range_value_t<A> lo, std::ranges::range_value_t<A> hi, Out&& out)
+	{
+		detail::transform_batch(out, a, [lo, hi](auto& o, auto x) { o = clamp(x, lo, hi); });
+	}
+	// out[i] = copysign(a[i], b[i])
+	template<fixed_range A, fixed_range B, fixed_range Out>
+	constexpr void copysign(const A& a, const B& b, Out&& out)
+	{
+		detail::transform_batch(out, a, b, [](auto& o, auto x, auto y) { o = copysign(x, y); });
+	}
+	// out[i] = signum(a[i]), for a contiguous range of integers `out`
+	template<fixed_range A, std::ranges::contiguous_range Out>
+	constexpr void signum(const A& a, Out&& out)
+	{
+		auto* o = std::ranges::data(out);
+		const auto* x = std::ranges::data(a);
+		for (std::size_t i = 0; i < std::ranges::size(out); i++)
+		{
+			o[i] = static_cast<std::ranges::range_value_t<Out>>(signum(x[i]));
+		}
+	}
+	// out[i] = std::hash of a[i], for a contiguous range of std::size_t `out`
+	template<fixed_range A, std::ranges::contiguous_range Out>
+	constexpr void hash(const A& a, Out&& out)
+	{
+		auto* o = std::ranges::data(out);
+		const auto* x = std::ranges::data(a);
+		const std::hash<std::ranges::range_value_t<A>> hasher;
+		for (std::size_t i = 0; i < std::ranges::size(out); i++)
+		{
+			o[i] = hasher(x[i]);
+		}
+	}
+}
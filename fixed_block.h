@@ -0,0 +1,235 @@
+/*
+MIT License
+
+Copyright (c) 2024 supsm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "fixed.h"
+#include "fixed_batch.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace supsm
+{
+	namespace detail
+	{
+		// shift x left by `amount` bits, or right if negative
+		// shifts by the width of I or more give 0 (left) or 0/-1 (right) instead of being undefined
+		template<typename I>
+		constexpr I shift_signed(I x, int amount)
+		{
+			constexpr int bits = std::numeric_limits<I>::digits + std::is_signed_v<I>;
+			if (amount >= 0)
+			{
+				return amount >= bits ? I(0) : static_cast<I>(x << amount);
+			}
+			return static_cast<I>(x >> std::min(-amount, bits - 1));
+		}
+		
+		// exponent of a block whose mantissas are all 0, the same after any number of operations
+		// it is below any exponent reached in practice, so sums align to the other block without dropping bits,
+		// and leaves room to add two exponents without overflow
+		constexpr int zero_block_exponent = std::numeric_limits<int>::min() / 4;
+		
+		// store n integers with value in[i] * 2^in_exponent as mantissas of type T
+		// sharing one exponent, using as many bits of T as possible
+		// @return  the shared exponent, or zero_block_exponent if every in[i] is 0
+		template<typename T, typename I>
+		constexpr int normalize_block(const I* in, std::size_t n, int in_exponent, T* out)
+		{
+			using UI = std::make_unsigned_t<I>;
+			// OR of magnitudes has the same bit width as the largest magnitude
+			UI magnitudes = 0;
+			for (std::size_t i = 0; i < n; i++)
+			{
+				const UI x = static_cast<UI>(in[i]);
+				magnitudes |= std::is_signed_v<I> ? negate_if(x, sign_mask(x)) : x;
+			}
+			if (magnitudes == 0)
+			{
+				std::fill_n(out, n, T(0));
+				return zero_block_exponent;
+			}
+			const int shift = static_cast<int>(std::bit_width(magnitudes)) - std::numeric_limits<T>::digits;
+			for (std::size_t i = 0; i < n; i++)
+			{
+				// right shift in I, or left shift after narrowing (value then fits T)
+				out[i] = shift > 0 ? static_cast<T>(in[i] >> shift) : static_cast<T>(static_cast<T>(in[i]) << -shift);
+			}
+			return in_exponent + shift;
+		}
+	}
+	
+	// block floating point array
+	// elements are stored as T mantissas, and every BlockSize consecutive elements share
+	// one exponent; element i has value mantissa(i) * 2^exponent(i / BlockSize)
+	// this gives more dynamic range than a single scale_bits while keeping integer arithmetic
+	// rounding when converting or operating follows the right shift of the source type (towards negative infinity)
+	// @tparam T  signed integer mantissa type, at most 32 bits
+	// @tparam BlockSize  number of elements sharing an exponent
+	template<typename T, std::size_t BlockSize>
+	class block_fixed
+	{
+		static_assert(std::is_integral_v<T> && std::is_signed_v<T> && std::numeric_limits<T>::digits <= 31);
+		static_assert(BlockSize > 0);
+		
+		public:
+		using mantissa_type = T;
+		static constexpr std::size_t block_size = BlockSize;
+		
+		block_fixed() = default;
+		// n elements of value 0
+		explicit block_fixed(std::size_t n) : mantissa_data(n), exponent_data((n + BlockSize - 1) / BlockSize, detail::zero_block_exponent) {}
+		// convert fixed point values, choosing each block's exponent from its largest magnitude
+		template<fixed_range R>
+		explicit block_fixed(const R& values) : block_fixed(std::ranges::size(values))
+		{
+			assign(values);
+		}
+		
+		std::size_t size() const { return mantissa_data.size(); }
+		std::size_t blocks() const { return exponent_data.size(); }
+		std::span<T> mantissas() { return mantissa_data; }
+		std::span<const T> mantissas() const { return mantissa_data; }
+		std::span<int> exponents() { return exponent_data; }
+		std::span<const int> exponents() const { return exponent_data; }
+		
+		// replace contents with fixed point values, which must have size() elements
+		template<fixed_range R>
+		void assign(const R& values)
+		{
+			using F = std::ranges::range_value_t<R>;
+			using raw_type = typename F::internal_type;
+			const F* in = std::ranges::data(values);
+			for (std::size_t b = 0; b < blocks(); b++)
+			{
+				// copy raw_data out so it can be scanned as integers
+				raw_type raw[BlockSize];
+				const std::size_t n = block_length(b);
+				for (std::size_t i = 0; i < n; i++)
+				{
+					raw[i] = in[b * BlockSize + i].raw_data;
+				}
+				exponent_data[b] = detail::normalize_block(raw, n, -static_cast<int>(F::fractional_bits), mantissa_data.data() + b * BlockSize);
+			}
+		}
+		// convert to fixed point, writing size() elements to `out`
+		template<fixed_range Out>
+		void to_fixed(Out&& out) const
+		{
+			using F = std::ranges::range_value_t<Out>;
+			using raw_type = typename F::internal_type;
+			F* o = std::ranges::data(out);
+			for (std::size_t b = 0; b < blocks(); b++)
+			{
+				// one shift amount for the whole block
+				const int shift = exponent_data[b] + static_cast<int>(F::fractional_bits);
+				for (std::size_t i = b * BlockSize; i < b * BlockSize + block_length(b); i++)
+				{
+					// shifted at 64 bits, so narrow outputs are not truncated before shifting right
+					o[i].raw_data = static_cast<raw_type>(detail::shift_signed<std::int64_t>(mantissa_data[i], shift));
+				}
+			}
+		}
+		// single element as fixed point
+		template<typename F>
+		F get(std::size_t i) const
+		{
+			F result;
+			const int shift = exponent_data[i / BlockSize] + static_cast<int>(F::fractional_bits);
+			result.raw_data = static_cast<typename F::internal_type>(detail::shift_signed<std::int64_t>(mantissa_data[i], shift));
+			return result;
+		}
+		
+		// element-wise sum, aligning each pair of blocks to the larger exponent
+		// both operands must have the same size
+		friend block_fixed operator+(const block_fixed& left, const block_fixed& right)
+		{
+			block_fixed result(left.size());
+			for (std::size_t b = 0; b < left.blocks(); b++)
+			{
+				const int exponent = std::max(left.exponent_data[b], right.exponent_data[b]);
+				const int shift_l = left.exponent_data[b] - exponent, shift_r = right.exponent_data[b] - exponent;
+				std::int64_t sum[BlockSize];
+				const std::size_t offset = b * BlockSize, n = left.block_length(b);
+				for (std::size_t i = 0; i < n; i++)
+				{
+					sum[i] = detail::shift_signed<std::int64_t>(left.mantissa_data[offset + i], shift_l) + detail::shift_signed<std::int64_t>(right.mantissa_data[offset + i], shift_r);
+				}
+				result.exponent_data[b] = detail::normalize_block(sum, n, exponent, result.mantissa_data.data() + offset);
+			}
+			return result;
+		}
+		// element-wise product
+		// both operands must have the same size
+		friend block_fixed operator*(const block_fixed& left, const block_fixed& right)
+		{
+			block_fixed result(left.size());
+			for (std::size_t b = 0; b < left.blocks(); b++)
+			{
+				std::int64_t product[BlockSize];
+				const std::size_t offset = b * BlockSize, n = left.block_length(b);
+				for (std::size_t i = 0; i < n; i++)
+				{
+					product[i] = std::int64_t(left.mantissa_data[offset + i]) * right.mantissa_data[offset + i];
+				}
+				result.exponent_data[b] = detail::normalize_block(product, n, left.exponent_data[b] + right.exponent_data[b], result.mantissa_data.data() + offset);
+			}
+			return result;
+		}
+		// dot product of two arrays of the same size, returned as fixed point
+		// each block is accumulated exactly in 64 bits, then converted to F once per block
+		template<typename F>
+		friend F dot(const block_fixed& left, const block_fixed& right)
+		{
+			using raw_type = typename F::internal_type;
+			// drop low bits of each product if BlockSize products could overflow 64 bits
+			constexpr int guard = std::max(0, 2 * std::numeric_limits<T>::digits + static_cast<int>(std::bit_width(BlockSize)) - 63);
+			F result;
+			for (std::size_t b = 0; b < left.blocks(); b++)
+			{
+				std::int64_t sum = 0;
+				const std::size_t offset = b * BlockSize, n = left.block_length(b);
+				for (std::size_t i = 0; i < n; i++)
+				{
+					sum += (std::int64_t(left.mantissa_data[offset + i]) * right.mantissa_data[offset + i]) >> guard;
+				}
+				const int shift = left.exponent_data[b] + right.exponent_data[b] + guard + static_cast<int>(F::fractional_bits);
+				result.raw_data += static_cast<raw_type>(detail::shift_signed(sum, shift));
+			}
+			return result;
+		}
+		
+		private:
+		std::size_t block_length(std::size_t b) const { return std::min(BlockSize, size() - b * BlockSize); }
+		
+		std::vector<T> mantissa_data;
+		std::vector<int> exponent_data;
+	};
+}
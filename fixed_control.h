@@ -0,0 +1,155 @@
+/*
+MIT License
+
+Copyright (c) 2024 supsm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "fixed.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+
+namespace supsm
+{
+	// N independent PID controllers stored as structure of arrays, updated together once per tick
+	// - the derivative acts on the measurement (no kick on setpoint changes) and is low-pass filtered
+	// - the integrator saturates at the output limits (anti-windup)
+	// - proportional, integral and derivative terms are kept with 2 * scale_bits fractional bits
+	//   and summed before a single rounding rescale and saturation per output
+	// all loops run over contiguous arrays and are auto-vectorized
+	// ki and kd are per tick, i.e. ki = Ki * dt and kd = Kd / dt
+	// @tparam F  value and gain type, e.g. fixed<int32_t, 16>
+	template<typename F, std::size_t N>
+	class pid_bank
+	{
+		using raw_type = typename F::internal_type;
+		static_assert(std::is_signed_v<raw_type> && std::numeric_limits<raw_type>::digits <= 31);
+		static constexpr std::size_t scale = F::fractional_bits;
+		// bound for the proportional and derivative terms and integrator increments,
+		// so the sum of all terms cannot overflow
+		static constexpr std::int64_t term_limit = std::int64_t(1) << 60;
+		
+		public:
+		using value_type = F;
+		// derivative filter coefficient in [0, 1], 1 disables filtering
+		using filter_type = fixed<std::int32_t, 16>;
+		
+		// all gains are 0, filters are disabled and outputs are limited to the range of F
+		pid_bank()
+		{
+			kp.fill(F());
+			ki.fill(F());
+			kd.fill(F());
+			alpha.fill(filter_type(1));
+			lo.fill(std::numeric_limits<F>::lowest());
+			hi.fill(std::numeric_limits<F>::max());
+			reset();
+		}
+		
+		static constexpr std::size_t size() { return N; }
+		
+		void set_gains(std::size_t i, F proportional, F integral, F derivative)
+		{
+			kp[i] = proportional;
+			ki[i] = integral;
+			kd[i] = derivative;
+		}
+		// alpha = dt / (Tf + dt) for a filter time constant Tf
+		void set_filter(std::size_t i, filter_type coefficient) { alpha[i] = coefficient; }
+		// limits the output, and the integrator with it
+		void set_limits(std::size_t i, F low, F high)
+		{
+			lo[i] = low;
+			hi[i] = high;
+			integral_state[i] = std::clamp(integral_state[i], wide(low), wide(high));
+		}
+		
+		// clears the integrator and derivative of controller i
+		// measurement is the previous measurement for the first derivative
+		void reset(std::size_t i, F measurement = F())
+		{
+			integral_state[i] = 0;
+			derivative_state[i] = 0;
+			previous[i] = measurement;
+		}
+		void reset()
+		{
+			integral_state.fill(0);
+			derivative_state.fill(0);
+			previous.fill(F());
+		}
+		
+		// integral term of controller i, truncated to F
+		F integral(std::size_t i) const
+		{
+			F result;
+			result.raw_data = static_cast<raw_type>(integral_state[i] >> scale);
+			return result;
+		}
+		
+		// advance every controller by one tick
+		// every span must have at least N elements
+		void update(std::span<const F> setpoint, std::span<const F> measurement, std::span<F> output)
+		{
+			constexpr std::int64_t raw_min = std::numeric_limits<raw_type>::min(), raw_max = std::numeric_limits<raw_type>::max();
+			constexpr std::int64_t half = scale == 0 ? 0 : std::int64_t(1) << (scale - 1);
+			for (std::size_t i = 0; i < N; i++)
+			{
+				const std::int64_t pv = measurement[i].raw_data;
+				// saturated so products with gains fit in 63 bits
+				const std::int64_t error = std::clamp(setpoint[i].raw_data - pv, raw_min, raw_max);
+				const std::int64_t change = std::clamp(previous[i].raw_data - pv, raw_min, raw_max);
+				previous[i].raw_data = static_cast<raw_type>(pv);
+				
+				const std::int64_t p = std::clamp(error * kp[i].raw_data, -term_limit, term_limit);
+				const std::int64_t increment = std::clamp(error * ki[i].raw_data, -term_limit, term_limit);
+				const std::int64_t integ = std::clamp(integral_state[i] + increment, wide(lo[i]), wide(hi[i]));
+				integral_state[i] = integ;
+				
+				// d += (target - d) * alpha, split so the product stays in 64 bits
+				const std::int64_t target = std::clamp(change * kd[i].raw_data, -term_limit, term_limit);
+				const std::int64_t diff = target - derivative_state[i];
+				const std::int64_t a = alpha[i].raw_data;
+				const std::int64_t d = derivative_state[i] + (diff >> 16) * a + (((diff & 0xffff) * a) >> 16);
+				derivative_state[i] = d;
+				
+				const std::int64_t u = (p + integ + d + half) >> scale;
+				output[i].raw_data = static_cast<raw_type>(std::clamp(u, std::int64_t(lo[i].raw_data), std::int64_t(hi[i].raw_data)));
+			}
+		}
+		
+		private:
+		// x with 2 * scale_bits fractional bits
+		static constexpr std::int64_t wide(F x) { return std::int64_t(x.raw_data) * (std::int64_t(1) << scale); }
+		
+		std::array<F, N> kp, ki, kd;
+		std::array<filter_type, N> alpha;
+		std::array<F, N> lo, hi;
+		std::array<F, N> previous;
+		std::array<std::int64_t, N> integral_state, derivative_state;
+	};
+}
@@ -0,0 +1,151 @@
+/*
+MIT License
+
+Copyright (c) 2024 supsm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "fixed.h"
+
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace supsm
+{
+	// largest scale_bits supported for T by the runtime dispatchers
+	template<typename T>
+	constexpr std::size_t max_scale_bits = std::numeric_limits<std::make_unsigned_t<T>>::digits - 1;
+	
+	// call fn(std::integral_constant<std::size_t, S>{}) with S equal to the runtime `scale`
+	// fn is instantiated for every S in [0, MaxScale] and selected through a jump table,
+	// so the cost is one indirect call regardless of the number of cases
+	// all instantiations must return the same type
+	// @throws std::out_of_range  if scale > MaxScale
+	template<std::size_t MaxScale, typename Fn>
+	decltype(auto) dispatch_scale(std::size_t scale, Fn&& fn)
+	{
+		if (scale > MaxScale)
+		{
+			throw std::out_of_range("supsm::dispatch_scale: scale out of range");
+		}
+		return [&]<std::size_t... S>(std::index_sequence<S...>) -> decltype(auto)
+		{
+			using result_type = decltype(fn(std::integral_constant<std::size_t, 0>{}));
+			using entry_type = result_type (*)(Fn&);
+			static constexpr entry_type table[] = { [](Fn& f) -> result_type { return f(std::integral_constant<std::size_t, S>{}); }... };
+			return table[scale](fn);
+		}(std::make_index_sequence<MaxScale + 1>{});
+	}
+	
+	// array of fixed point numbers whose scale is only known at runtime,
+	// e.g. when it is read from a file header
+	// operations are written as generic kernels over std::span<fixed<T, S>> and run through
+	// visit(), which selects the compile-time specialized kernel once per call rather than per element
+	// @tparam T  internal type of the elements
+	template<typename T>
+	class dyn_fixed_array
+	{
+		public:
+		using internal_type = T;
+		template<std::size_t S>
+		using fixed_type = fixed<T, S>;
+		static constexpr std::size_t max_scale = max_scale_bits<T>;
+		
+		// n elements of value 0
+		// @throws std::out_of_range  if scale > max_scale
+		explicit dyn_fixed_array(std::size_t scale, std::size_t n = 0) : scale_bits(scale), data(n)
+		{
+			if (scale > max_scale)
+			{
+				throw std::out_of_range("supsm::dyn_fixed_array: scale out of range");
+			}
+		}
+		
+		std::size_t scale() const { return scale_bits; }
+		std::size_t size() const { return data.size(); }
+		void resize(std::size_t n) { data.resize(n); }
+		// underlying raw_data of the elements
+		std::span<T> raw() { return data; }
+		std::span<const T> raw() const { return data; }
+		
+		// elements as fixed<T, S>; S must equal scale()
+		template<std::size_t S>
+		std::span<fixed_type<S>> as()
+		{
+			static_assert(sizeof(fixed_type<S>) == sizeof(T) && std::is_standard_layout_v<fixed_type<S>>);
+			return { reinterpret_cast<fixed_type<S>*>(data.data()), data.size() };
+		}
+		template<std::size_t S>
+		std::span<const fixed_type<S>> as() const
+		{
+			return { reinterpret_cast<const fixed_type<S>*>(data.data()), data.size() };
+		}
+		
+		// call fn(std::span<fixed<T, scale()>>), instantiating fn for every possible scale
+		template<typename Fn>
+		decltype(auto) visit(Fn&& fn)
+		{
+			return dispatch_scale<max_scale>(scale_bits, [&](auto s) -> decltype(auto) { return fn(as<decltype(s)::value>()); });
+		}
+		template<typename Fn>
+		decltype(auto) visit(Fn&& fn) const
+		{
+			return dispatch_scale<max_scale>(scale_bits, [&](auto s) -> decltype(auto) { return fn(as<decltype(s)::value>()); });
+		}
+		
+		// element i converted to F
+		template<typename F>
+		F get(std::size_t i) const
+		{
+			return visit([i](auto elements) { return fixed_cast<F>(elements[i]); });
+		}
+		// store value at element i, converting to the array's scale
+		template<typename F>
+		void set(std::size_t i, const F& value)
+		{
+			visit([i, &value](auto elements) { elements[i] = fixed_cast<typename decltype(elements)::value_type>(value); });
+		}
+		
+		// change the scale of every element (truncating fractional bits if decreasing)
+		// @throws std::out_of_range  if scale > max_scale
+		void rescale(std::size_t scale)
+		{
+			if (scale > max_scale)
+			{
+				throw std::out_of_range("supsm::dyn_fixed_array: scale out of range");
+			}
+			const int shift = static_cast<int>(scale) - static_cast<int>(scale_bits);
+			for (T& x : data)
+			{
+				x = shift >= 0 ? static_cast<T>(x << shift) : static_cast<T>(x >> -shift);
+			}
+			scale_bits = scale;
+		}
+		
+		private:
+		std::size_t scale_bits;
+		std::vector<T> data;
+	};
+}
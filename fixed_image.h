@@ -0,0 +1,567 @@
+/*
+MIT License
+
+Copyright (c) 2024 supsm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "fixed.h"
+#include "fixed_batch.h"
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// compositing kernels on pixel channels, deterministic and exactly rounded
+// two channel formats are supported:
+// - channel8 stores 8 bit channels, where raw 255 means 1.0 (fully opaque), as in
+//   common 8 bit images; normalized products use an exact divide by 255
+// - channel16 stores raw 256 as 1.0, which is exactly fixed<uint16_t, 8>(1), so
+//   normalized products are ordinary fixed point multiplication with rounding
+// images are either planar (one range per channel) or interleaved with alpha last
+// (RGBA, BGRA, ...), and color may be straight or premultiplied by alpha as noted
+namespace supsm
+{
+	using channel8 = fixed<std::uint8_t, 8>;
+	using channel16 = fixed<std::uint16_t, 8>;
+	
+	template<typename Ch>
+	concept pixel_channel = std::same_as<Ch, channel8> || std::same_as<Ch, channel16>;
+	// contiguous range of pixel channels
+	template<typename R>
+	concept channel_range = fixed_range<R> && pixel_channel<std::ranges::range_value_t<R>>;
+	
+	namespace detail
+	{
+		// raw value of 1.0
+		template<typename Ch>
+		constexpr std::uint32_t channel_one = std::same_as<Ch, channel8> ? 255 : 256;
+		
+		// round(x / 255) for x <= 65535 + 127, without a division
+		constexpr std::uint32_t div255(std::uint32_t x)
+		{
+			x += 128;
+			return (x + (x >> 8)) >> 8;
+		}
+		// round(a * b / one)
+		template<typename Ch>
+		constexpr std::uint32_t mul_norm(std::uint32_t a, std::uint32_t b)
+		{
+			if constexpr (std::same_as<Ch, channel8>)
+			{
+				return div255(a * b);
+			}
+			else
+			{
+				return (a * b + 128) >> 8;
+			}
+		}
+		
+		// ceil(2^26 / a), so that (n * table[a]) >> 26 == n / a exactly for n < 2^17
+		constexpr std::array<std::uint32_t, 257> reciprocal_table = []
+		{
+			std::array<std::uint32_t, 257> table{};
+			for (std::uint32_t a = 1; a < table.size(); a++)
+			{
+				table[a] = static_cast<std::uint32_t>(((std::uint64_t(1) << 26) + a - 1) / a);
+			}
+			return table;
+		}();
+		// round(c * one / a) limited to one, or 0 for a == 0
+		// alpha above one (possible in channel16) is treated as one, which also bounds the table index
+		template<typename Ch>
+		constexpr std::uint32_t div_norm(std::uint32_t c, std::uint32_t alpha)
+		{
+			constexpr std::uint32_t one = channel_one<Ch>;
+			// not std::min, whose reference parameters keep alpha in memory and stop vectorization
+			const std::uint32_t a = alpha < one ? alpha : one;
+			const std::uint64_t quotient = (std::uint64_t(c * one + (a >> 1)) * reciprocal_table[a]) >> 26;
+			return static_cast<std::uint32_t>(std::min<std::uint64_t>(quotient, one));
+		}
+		
+		// round((x * (one - w) + y * w) / one), with a single rounding for the sum
+		// w above one (possible in channel16) is treated as one
+		template<typename Ch>
+		constexpr std::uint32_t lerp_norm(std::uint32_t x, std::uint32_t y, std::uint32_t w)
+		{
+			w = std::min(w, channel_one<Ch>);
+			const std::uint32_t sum = x * (channel_one<Ch> - w) + y * w;
+			if constexpr (std::same_as<Ch, channel8>)
+			{
+				return div255(sum);
+			}
+			else
+			{
+				return (sum + 128) >> 8;
+			}
+		}
+		
+		template<typename Ch>
+		constexpr Ch make_channel(std::uint32_t raw)
+		{
+			Ch result;
+			result.raw_data = static_cast<typename Ch::internal_type>(raw);
+			return result;
+		}
+	}
+	
+	// out[i] = in[i] converted from channel8 to channel16, round(x * 256 / 255)
+	template<fixed_range In, fixed_range Out>
+		requires std::same_as<std::ranges::range_value_t<In>, channel8> && std::same_as<std::ranges::range_value_t<Out>, channel16>
+	constexpr void to_channel16(const In& in, Out&& out)
+	{
+		detail::transform_batch(out, in, [](auto& o, auto x) { o.raw_data = static_cast<std::uint16_t>(detail::div255(std::uint32_t(x.raw_data) << 8)); });
+	}
+	// out[i] = in[i] converted from channel16 to channel8, round(x * 255 / 256)
+	// to_channel8 after to_channel16 gives back the original values
+	template<fixed_range In, fixed_range Out>
+		requires std::same_as<std::ranges::range_value_t<In>, channel16> && std::same_as<std::ranges::range_value_t<Out>, channel8>
+	constexpr void to_channel8(const In& in, Out&& out)
+	{
+		detail::transform_batch(out, in, [](auto& o, auto x) { o.raw_data = static_cast<std::uint8_t>((std::uint32_t(x.raw_data) * 255 + 128) >> 8); });
+	}
+	
+	// planar: out[i] = color[i] * alpha[i]
+	template<channel_range C, channel_range A, channel_range Out>
+	constexpr void premultiply(const C& color, const A& alpha, Out&& out)
+	{
+		using Ch = std::ranges::range_value_t<Out>;
+		detail::transform_batch(out, color, alpha, [](auto& o, auto c, auto a) { o = detail::make_channel<Ch>(detail::mul_norm<Ch>(c.raw_data, a.raw_data)); });
+	}
+	// planar: out[i] = color[i] / alpha[i], or 0 where alpha is 0
+	// uses a reciprocal table rather than a division per channel
+	template<channel_range C, channel_range A, channel_range Out>
+	constexpr void unpremultiply(const C& color, const A& alpha, Out&& out)
+	{
+		using Ch = std::ranges::range_value_t<Out>;
+		detail::transform_batch(out, color, alpha, [](auto& o, auto c, auto a) { o = detail::make_channel<Ch>(detail::div_norm<Ch>(c.raw_data, a.raw_data)); });
+	}
+	// planar, premultiplied source over destination: out[i] = src[i] + dst[i] * (1 - src_alpha[i])
+	// also applies to the alpha plane, with src = src_alpha
+	// alpha above one (possible in channel16) is treated as one
+	template<channel_range S, channel_range SA, channel_range D, channel_range Out>
+	constexpr void over(const S& src, const SA& src_alpha, const D& dst, Out&& out)
+	{
+		using Ch = std::ranges::range_value_t<Out>;
+		const auto* sa = std::ranges::data(src_alpha);
+		detail::transform_batch(out, src, dst, [&sa](auto& o, auto s, auto d)
+		{
+			constexpr std::uint32_t one = detail::channel_one<Ch>;
+			const std::uint32_t alpha = (sa++)->raw_data;
+			o = detail::make_channel<Ch>(s.raw_data + detail::mul_norm<Ch>(d.raw_data, one - std::min(alpha, one)));
+		});
+	}
+	// planar: out[i] = a[i] + (b[i] - a[i]) * t[i], with t in [0, 1]
+	template<channel_range A, channel_range B, channel_range T, channel_range Out>
+	constexpr void lerp(const A& a, const B& b, const T& t, Out&& out)
+	{
+		using Ch = std::ranges::range_value_t<Out>;
+		const auto* weight = std::ranges::data(t);
+		detail::transform_batch(out, a, b, [&weight](auto& o, auto x, auto y) { o = detail::make_channel<Ch>(detail::lerp_norm<Ch>(x.raw_data, y.raw_data, (weight++)->raw_data)); });
+	}
+	// planar: out[i] = a[i] + (b[i] - a[i]) * t, e.g. a crossfade
+	template<channel_range A, channel_range B, channel_range Out>
+	constexpr void lerp(const A& a, const B& b, std::ranges::range_value_t<Out> t, Out&& out)
+	{
+		using Ch = std::ranges::range_value_t<Out>;
+		detail::transform_batch(out, a, b, [t](auto& o, auto x, auto y) { o = detail::make_channel<Ch>(detail::lerp_norm<Ch>(x.raw_data, y.raw_data, t.raw_data)); });
+	}
+	
+	// interleaved versions, 4 channels per pixel with alpha last
+	// every range holds 4 * pixels channels
+	
+	// color channels multiplied by alpha, alpha unchanged
+	template<channel_range In, channel_range Out>
+	constexpr void premultiply_rgba(const In& in, Out&& out)
+	{
+		using Ch = std::ranges::range_value_t<Out>;
+		const auto* x = std::ranges::data(in);
+		auto* o = std::ranges::data(out);
+		for (std::size_t p = 0; p < std::ranges::size(out); p += 4)
+		{
+			const std::uint32_t a = x[p + 3].raw_data;
+			for (std::size_t c = 0; c < 3; c++)
+			{
+				o[p + c] = detail::make_channel<Ch>(detail::mul_norm<Ch>(x[p + c].raw_data, a));
+			}
+			o[p + 3] = detail::make_channel<Ch>(x[p + 3].raw_data);
+		}
+	}
+	// color channels divided by alpha (0 where alpha is 0), alpha unchanged
+	template<channel_range In, channel_range Out>
+	constexpr void unpremultiply_rgba(const In& in, Out&& out)
+	{
+		using Ch = std::ranges::range_value_t<Out>;
+		const auto* x = std::ranges::data(in);
+		auto* o = std::ranges::data(out);
+		for (std::size_t p = 0; p < std::ranges::size(out); p += 4)
+		{
+			const std::uint32_t a = x[p + 3].raw_data;
+			for (std::size_t c = 0; c < 3; c++)
+			{
+				o[p + c] = detail::make_channel<Ch>(detail::div_norm<Ch>(x[p + c].raw_data, a));
+			}
+			o[p + 3] = detail::make_channel<Ch>(x[p + 3].raw_data);
+		}
+	}
+	// premultiplied source over destination, for all 4 channels
+	// alpha above one (possible in channel16) is treated as one
+	template<channel_range S, channel_range D, channel_range Out>
+	constexpr void over_rgba(const S& src, const D& dst, Out&& out)
+	{
+		using Ch = std::ranges::range_value_t<Out>;
+		constexpr std::uint32_t one = detail::channel_one<Ch>;
+		const auto* s = std::ranges::data(src);
+		const auto* d = std::ranges::data(dst);
+		auto* o = std::ranges::data(out);
+		for (std::size_t p = 0; p < std::ranges::size(out); p += 4)
+		{
+			const std::uint32_t inverse = one - std::min<std::uint32_t>(s[p + 3].raw_data, one);
+			for (std::size_t c = 0; c < 4; c++)
+			{
+				o[p + c] = detail::make_channel<Ch>(s[p + c].raw_data + detail::mul_norm<Ch>(d[p + c].raw_data, inverse));
+			}
+		}
+	}
+	
+	// color space conversion
+	// YUV data is 8 bit limited range (Y in [16, 235], U and V in [16, 240]), in tightly packed planes:
+	// - I420: full resolution Y plane, then U and V planes subsampled 2x2
+	// - NV12: full resolution Y plane, then one plane of interleaved U, V pairs subsampled 2x2
+	// RGB data is interleaved, 3 bytes per pixel
+	// the matrix coefficients are fixed<int32_t, 14> constants derived at compile time from the
+	// standard, and each output channel is rescaled and rounded once
+	
+	// luma weights of a YUV standard
+	struct yuv_standard
+	{
+		double kr, kb;
+	};
+	constexpr yuv_standard bt601{ 0.299, 0.114 };
+	constexpr yuv_standard bt709{ 0.2126, 0.0722 };
+	
+	namespace detail
+	{
+		using yuv_coefficient = fixed<std::int32_t, 14>;
+		
+		constexpr yuv_coefficient make_coefficient(double x)
+		{
+			yuv_coefficient result;
+			result.raw_data = static_cast<std::int32_t>(x * (1 << 14) + (x < 0 ? -0.5 : 0.5));
+			return result;
+		}
+		
+		template<yuv_standard S>
+		struct yuv_matrix
+		{
+			static constexpr double kg = 1 - S.kr - S.kb;
+			static constexpr double y_range = 219.0 / 255, c_range = 224.0 / 255;
+			// YUV to RGB
+			static constexpr yuv_coefficient y = make_coefficient(1 / y_range);
+			static constexpr yuv_coefficient r_v = make_coefficient(2 * (1 - S.kr) / c_range);
+			static constexpr yuv_coefficient g_u = make_coefficient(-2 * (1 - S.kb) * S.kb / kg / c_range);
+			static constexpr yuv_coefficient g_v = make_coefficient(-2 * (1 - S.kr) * S.kr / kg / c_range);
+			static constexpr yuv_coefficient b_u = make_coefficient(2 * (1 - S.kb) / c_range);
+			// RGB to YUV
+			static constexpr yuv_coefficient y_r = make_coefficient(S.kr * y_range);
+			static constexpr yuv_coefficient y_g = make_coefficient(kg * y_range);
+			static constexpr yuv_coefficient y_b = make_coefficient(S.kb * y_range);
+			static constexpr yuv_coefficient u_r = make_coefficient(-S.kr * c_range / (2 * (1 - S.kb)));
+			static constexpr yuv_coefficient u_g = make_coefficient(-kg * c_range / (2 * (1 - S.kb)));
+			static constexpr yuv_coefficient u_b = make_coefficient(c_range / 2);
+			static constexpr yuv_coefficient v_r = make_coefficient(c_range / 2);
+			static constexpr yuv_coefficient v_g = make_coefficient(-kg * c_range / (2 * (1 - S.kr)));
+			static constexpr yuv_coefficient v_b = make_coefficient(-S.kb * c_range / (2 * (1 - S.kr)));
+		};
+		
+		// round(x) + offset limited to [0, 255], where x has extra_bits more fractional bits than yuv_coefficient
+		template<std::size_t extra_bits = 0>
+		constexpr std::uint8_t rescale_to_byte(yuv_coefficient x, std::int32_t offset)
+		{
+			constexpr int shift = 14 + extra_bits;
+			return static_cast<std::uint8_t>(std::clamp(((x.raw_data + (1 << (shift - 1))) >> shift) + offset, 0, 255));
+		}
+	}
+	
+	// one pixel from YUV to RGB; this is the reference that every kernel below matches exactly
+	template<yuv_standard S = bt601>
+	constexpr std::array<std::uint8_t, 3> yuv_to_rgb(std::uint8_t y, std::uint8_t u, std::uint8_t v)
+	{
+		using m = detail::yuv_matrix<S>;
+		const detail::yuv_coefficient luma = m::y * (y - 16);
+		const int cu = u - 128, cv = v - 128;
+		return { detail::rescale_to_byte(luma + m::r_v * cv, 0),
+			detail::rescale_to_byte(luma + m::g_u * cu + m::g_v * cv, 0),
+			detail::rescale_to_byte(luma + m::b_u * cu, 0) };
+	}
+	// luma of one RGB pixel
+	template<yuv_standard S = bt601>
+	constexpr std::uint8_t rgb_to_y(std::uint8_t r, std::uint8_t g, std::uint8_t b)
+	{
+		using m = detail::yuv_matrix<S>;
+		return detail::rescale_to_byte(m::y_r * r + m::y_g * g + m::y_b * b, 16);
+	}
+	// chroma of the sums of 4 RGB pixels (a 2x2 block), averaged in the same rescale
+	template<yuv_standard S = bt601>
+	constexpr std::array<std::uint8_t, 2> rgb_to_uv(int r_sum, int g_sum, int b_sum)
+	{
+		using m = detail::yuv_matrix<S>;
+		return { detail::rescale_to_byte<2>(m::u_r * r_sum + m::u_g * g_sum + m::u_b * b_sum, 128),
+			detail::rescale_to_byte<2>(m::v_r * r_sum + m::v_g * g_sum + m::v_b * b_sum, 128) };
+	}
+	
+	namespace detail
+	{
+		// chroma samples are at u[i * step] and v[i * step]
+		// rows are converted in pairs sharing a chroma row, a tile of pixels at a time: the chroma terms
+		// of the tile are computed once per sample and upsampled into temporary rows, so that every
+		// loop runs over contiguous samples without a per-pixel index division and is auto-vectorized
+		// the raw arithmetic is the same as in yuv_to_rgb, so the results are identical
+		template<yuv_standard S, std::size_t step>
+		void yuv420_to_rgb(std::span<const std::uint8_t> y_plane, const std::uint8_t* u, const std::uint8_t* v,
+			std::span<std::uint8_t> rgb, std::size_t width, std::size_t height)
+		{
+			using m = yuv_matrix<S>;
+			constexpr std::size_t tile = 64;
+			constexpr std::int32_t half = 1 << 13;
+			const std::size_t chroma_width = (width + 1) / 2;
+			std::array<std::int32_t, tile> red, green, blue;
+			for (std::size_t row = 0; row < height; row += 2)
+			{
+				const std::size_t rows = std::min<std::size_t>(2, height - row);
+				const std::size_t chroma_row = (row / 2) * chroma_width;
+				for (std::size_t x = 0; x < width; x += tile)
+				{
+					const std::size_t n = std::min(tile, width - x);
+					const std::uint8_t* tile_u = u + (chroma_row + x / 2) * step;
+					const std::uint8_t* tile_v = v + (chroma_row + x / 2) * step;
+					// rounding is folded into the chroma terms
+					for (std::size_t i = 0; i < (n + 1) / 2; i++)
+					{
+						const std::int32_t cu = tile_u[i * step] - 128, cv = tile_v[i * step] - 128;
+						const std::int32_t r = m::r_v.raw_data * cv + half;
+						const std::int32_t g = m::g_u.raw_data * cu + m::g_v.raw_data * cv + half;
+						const std::int32_t b = m::b_u.raw_data * cu + half;
+						red[2 * i] = red[2 * i + 1] = r;
+						green[2 * i] = green[2 * i + 1] = g;
+						blue[2 * i] = blue[2 * i + 1] = b;
+					}
+					for (std::size_t r = 0; r < rows; r++)
+					{
+						const std::uint8_t* y_row = y_plane.data() + (row + r) * width + x;
+						std::uint8_t* out = rgb.data() + ((row + r) * width + x) * 3;
+						for (std::size_t i = 0; i < n; i++)
+						{
+							const std::int32_t luma = m::y.raw_data * (y_row[i] - 16);
+							out[i * 3] = static_cast<std::uint8_t>(std::clamp((luma + red[i]) >> 14, 0, 255));
+							out[i * 3 + 1] = static_cast<std::uint8_t>(std::clamp((luma + green[i]) >> 14, 0, 255));
+							out[i * 3 + 2] = static_cast<std::uint8_t>(std::clamp((luma + blue[i]) >> 14, 0, 255));
+						}
+					}
+				}
+			}
+		}
+		template<yuv_standard S>
+		void rgb_to_yuv420(std::span<const std::uint8_t> rgb, std::span<std::uint8_t> y_plane, std::uint8_t* u, std::uint8_t* v, std::size_t step,
+			std::size_t width, std::size_t height)
+		{
+			for (std::size_t i = 0; i < width * height; i++)
+			{
+				y_plane[i] = rgb_to_y<S>(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+			}
+			const std::size_t chroma_width = (width + 1) / 2;
+			for (std::size_t row = 0; row < height; row += 2)
+			{
+				// odd sizes repeat the last row or column
+				const std::size_t rows[2] = { row, std::min(row + 1, height - 1) };
+				for (std::size_t x = 0; x < width; x += 2)
+				{
+					const std::size_t columns[2] = { x, std::min(x + 1, width - 1) };
+					int sum[3] = { 0, 0, 0 };
+					for (std::size_t r : rows)
+					{
+						for (std::size_t col : columns)
+						{
+							for (int ch = 0; ch < 3; ch++)
+							{
+								sum[ch] += rgb[(r * width + col) * 3 + ch];
+							}
+						}
+					}
+					const auto chroma = rgb_to_uv<S>(sum[0], sum[1], sum[2]);
+					const std::size_t c = ((row / 2) * chroma_width + x / 2) * step;
+					u[c] = chroma[0];
+					v[c] = chroma[1];
+				}
+			}
+		}
+	}
+	
+	// I420 (planar Y, U, V) to interleaved RGB
+	template<yuv_standard S = bt601>
+	void i420_to_rgb(std::span<const std::uint8_t> y, std::span<const std::uint8_t> u, std::span<const std::uint8_t> v, std::span<std::uint8_t> rgb,
+		std::size_t width, std::size_t height)
+	{
+		detail::yuv420_to_rgb<S, 1>(y, u.data(), v.data(), rgb, width, height);
+	}
+	// NV12 (Y plane, interleaved UV plane) to interleaved RGB
+	template<yuv_standard S = bt601>
+	void nv12_to_rgb(std::span<const std::uint8_t> y, std::span<const std::uint8_t> uv, std::span<std::uint8_t> rgb, std::size_t width, std::size_t height)
+	{
+		detail::yuv420_to_rgb<S, 2>(y, uv.data(), uv.data() + 1, rgb, width, height);
+	}
+	// interleaved RGB to I420, averaging each 2x2 block for chroma
+	template<yuv_standard S = bt601>
+	void rgb_to_i420(std::span<const std::uint8_t> rgb, std::span<std::uint8_t> y, std::span<std::uint8_t> u, std::span<std::uint8_t> v,
+		std::size_t width, std::size_t height)
+	{
+		detail::rgb_to_yuv420<S>(rgb, y, u.data(), v.data(), 1, width, height);
+	}
+	// interleaved RGB to NV12, averaging each 2x2 block for chroma
+	template<yuv_standard S = bt601>
+	void rgb_to_nv12(std::span<const std::uint8_t> rgb, std::span<std::uint8_t> y, std::span<std::uint8_t> uv, std::size_t width, std::size_t height)
+	{
+		detail::rgb_to_yuv420<S>(rgb, y, uv.data(), uv.data() + 1, 2, width, height);
+	}
+	
+	// linear light channel, 1.0 is raw 32768
+	using linear16 = fixed<std::uint16_t, 15>;
+	
+	namespace detail
+	{
+		// constexpr replacements for std::log and std::exp (not constexpr until C++26),
+		// accurate to double precision over the ranges used for the tables
+		constexpr double cx_log(double x)
+		{
+			constexpr double ln2 = 0.693147180559945309417;
+			int exponent = 0;
+			while (x >= 2)
+			{
+				x /= 2;
+				exponent++;
+			}
+			while (x < 1)
+			{
+				x *= 2;
+				exponent--;
+			}
+			// log(x) = 2 atanh((x - 1) / (x + 1))
+			const double t = (x - 1) / (x + 1), t2 = t * t;
+			double term = t, sum = 0;
+			for (int i = 1; i < 60; i += 2)
+			{
+				sum += term / i;
+				term *= t2;
+			}
+			return 2 * sum + exponent * ln2;
+		}
+		constexpr double cx_exp(double x)
+		{
+			constexpr double ln2 = 0.693147180559945309417;
+			const int k = static_cast<int>(x / ln2 + (x < 0 ? -0.5 : 0.5));
+			const double r = x - k * ln2;
+			double term = 1, sum = 1;
+			for (int i = 1; i < 30; i++)
+			{
+				term *= r / i;
+				sum += term;
+			}
+			for (int i = 0; i < k; i++)
+			{
+				sum *= 2;
+			}
+			for (int i = 0; i > k; i--)
+			{
+				sum /= 2;
+			}
+			return sum;
+		}
+		// sRGB transfer function, encoded value in [0, 1] to linear
+		constexpr double srgb_decode(double c)
+		{
+			return c <= 0.04045 ? c / 12.92 : cx_exp(2.4 * cx_log((c + 0.055) / 1.055));
+		}
+		
+		constexpr std::array<std::uint16_t, 256> srgb_to_linear_table = []
+		{
+			std::array<std::uint16_t, 256> table{};
+			for (std::size_t k = 0; k < table.size(); k++)
+			{
+				table[k] = static_cast<std::uint16_t>(srgb_decode(k / 255.0) * 32768 + 0.5);
+			}
+			return table;
+		}();
+		// smallest linear16 raw value that encodes to code k, i.e. the linear value of (k - 0.5) / 255 rounded up
+		constexpr std::array<std::uint32_t, 257> srgb_thresholds = []
+		{
+			std::array<std::uint32_t, 257> table{};
+			for (std::size_t k = 1; k < 256; k++)
+			{
+				const double threshold = srgb_decode((k - 0.5) / 255) * 32768;
+				table[k] = static_cast<std::uint32_t>(threshold) + (static_cast<std::uint32_t>(threshold) < threshold);
+			}
+			// never reached
+			table[256] = ~std::uint32_t(0);
+			return table;
+		}();
+		// code of the first linear16 raw value of each bucket of 8
+		// thresholds are more than 8 apart, so each bucket contains at most one
+		constexpr std::array<std::uint8_t, (32768 >> 3) + 1> linear_to_srgb_table = []
+		{
+			std::array<std::uint8_t, (32768 >> 3) + 1> table{};
+			std::uint32_t code = 0;
+			for (std::uint32_t i = 0; i < table.size(); i++)
+			{
+				while (code < 255 && srgb_thresholds[code + 1] <= (i << 3))
+				{
+					code++;
+				}
+				table[i] = static_cast<std::uint8_t>(code);
+			}
+			return table;
+		}();
+	}
+	
+	// out[i] = linear light value of sRGB encoded in[i], through a 256 entry table
+	template<fixed_range In, fixed_range Out>
+		requires std::same_as<std::ranges::range_value_t<In>, channel8> && std::same_as<std::ranges::range_value_t<Out>, linear16>
+	constexpr void srgb_to_linear(const In& in, Out&& out)
+	{
+		detail::transform_batch(out, in, [](auto& o, auto x) { o.raw_data = detail::srgb_to_linear_table[x.raw_data]; });
+	}
+	// out[i] = sRGB encoding of linear in[i], correctly rounded to 8 bits
+	// values above 1.0 are clamped to 1.0
+	// a table lookup on the high bits followed by one comparison against the next threshold
+	template<fixed_range In, fixed_range Out>
+		requires std::same_as<std::ranges::range_value_t<In>, linear16> && std::same_as<std::ranges::range_value_t<Out>, channel8>
+	constexpr void linear_to_srgb(const In& in, Out&& out)
+	{
+		detail::transform_batch(out, in, [](auto& o, auto x)
+		{
+			const std::uint32_t linear = std::min<std::uint32_t>(x.raw_data, 32768);
+			const std::uint8_t code = detail::linear_to_srgb_table[linear >> 3];
+			o.raw_data = static_cast<std::uint8_t>(code + (linear >= detail::srgb_thresholds[code + 1]));
+		});
+	}
+}
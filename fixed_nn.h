@@ -0,0 +1,449 @@
+/*
+MIT License
+
+Copyright (c) 2024 supsm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "fixed.h"
+#include "fixed_batch.h"
+#include "fixed_quant.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// integer-only neural network layers on fixed<int8_t/int16_t, S>
+// - tensors are single samples (or [rows][features] for dense/layernorm), channels first
+// - accumulation is exact in nn_accumulator_t
+// - every layer ends with explicit requantization to the output format through a
+//   requantizer span holding either one entry or one entry per output channel;
+//   per-channel weight scales can be folded into these
+// - bias/beta are raw accumulator values (at the accumulator's scale)
+namespace supsm
+{
+	// exact accumulator for products of Ti and Tw
+	template<typename Ti, typename Tw>
+	using nn_accumulator_t = std::conditional_t<(std::numeric_limits<Ti>::digits + std::numeric_limits<Tw>::digits <= 16), std::int32_t, std::int64_t>;
+	
+	namespace detail
+	{
+		template<fixed_range R>
+		using raw_type_of = typename std::ranges::range_value_t<R>::internal_type;
+		
+		// out[m * out_stride_m + n * out_stride_n] = rq[n].apply(bias[n] + sum_k a[m][k] * b[n][k])
+		// a is [M][K], b is [N][K], so every output is a contiguous dot product
+		template<typename Acc, typename Fa, typename Fb, typename Fo>
+		void gemm_requantize(const Fa* a, const Fb* b, std::span<const Acc> bias, std::span<const requantizer> rq, Fo* out,
+			std::size_t M, std::size_t N, std::size_t K, std::size_t out_stride_m, std::size_t out_stride_n)
+		{
+			for (std::size_t n = 0; n < N; n++)
+			{
+				const Fb* weights = b + n * K;
+				const requantizer& r = rq[rq.size() == 1 ? 0 : n];
+				const Acc initial = bias.empty() ? Acc(0) : bias[n];
+				for (std::size_t m = 0; m < M; m++)
+				{
+					const Fa* inputs = a + m * K;
+					Acc sum = initial;
+					for (std::size_t k = 0; k < K; k++)
+					{
+						sum += static_cast<Acc>(inputs[k].raw_data) * weights[k].raw_data;
+					}
+					out[m * out_stride_m + n * out_stride_n].raw_data = r.apply<typename Fo::internal_type>(sum);
+				}
+			}
+		}
+		
+		// integer square root, floor(sqrt(x))
+		constexpr std::uint64_t isqrt(std::uint64_t x)
+		{
+			std::uint64_t result = 0;
+			// from the highest power of 4 down
+			for (std::uint64_t bit = std::uint64_t(1) << 62; bit != 0; bit >>= 2)
+			{
+				if (x >= result + bit)
+				{
+					x -= result + bit;
+					result = (result >> 1) + bit;
+				}
+				else
+				{
+					result >>= 1;
+				}
+			}
+			return result;
+		}
+	}
+	
+	// fully connected layer
+	// output[row][o] = rq(bias[o] + sum_i input[row][i] * weights[o][i])
+	// @param input  [rows][in_features]
+	// @param weights  [out_features][in_features]
+	// @param bias  [out_features] raw accumulator values, or empty
+	// @param output  [rows][out_features]
+	template<fixed_range In, fixed_range W, fixed_range Out>
+	void dense(const In& input, const W& weights, std::span<const nn_accumulator_t<detail::raw_type_of<In>, detail::raw_type_of<W>>> bias,
+		std::span<const requantizer> rq, Out&& output, std::size_t in_features)
+	{
+		using Acc = nn_accumulator_t<detail::raw_type_of<In>, detail::raw_type_of<W>>;
+		const std::size_t out_features = std::ranges::size(weights) / in_features;
+		const std::size_t rows = std::ranges::size(input) / in_features;
+		detail::gemm_requantize<Acc>(std::ranges::data(input), std::ranges::data(weights), bias, rq, std::ranges::data(output),
+			rows, out_features, in_features, out_features, 1);
+	}
+	
+	struct conv2d_shape
+	{
+		std::size_t in_channels, height, width;
+		std::size_t out_channels, kernel_height, kernel_width;
+		std::size_t stride_y = 1, stride_x = 1;
+		std::size_t pad_y = 0, pad_x = 0;
+		
+		constexpr std::size_t out_height() const { return (height + 2 * pad_y - kernel_height) / stride_y + 1; }
+		constexpr std::size_t out_width() const { return (width + 2 * pad_x - kernel_width) / stride_x + 1; }
+	};
+	
+	// 2d convolution through im2col and a single GEMM; padding is 0
+	// @param input  [in_channels][height][width]
+	// @param weights  [out_channels][in_channels][kernel_height][kernel_width]
+	// @param bias  [out_channels] raw accumulator values, or empty
+	// @param output  [out_channels][out_height][out_width]
+	// @param scratch  memory for the im2col buffer, e.g. a fixed_arena
+	template<fixed_range In, fixed_range W, fixed_range Out>
+	void conv2d(const In& input, const W& weights, std::span<const nn_accumulator_t<detail::raw_type_of<In>, detail::raw_type_of<W>>> bias,
+		std::span<const requantizer> rq, Out&& output, const conv2d_shape& shape, std::pmr::memory_resource* scratch = std::pmr::get_default_resource())
+	{
+		using Fi = std::ranges::range_value_t<In>;
+		using Acc = nn_accumulator_t<detail::raw_type_of<In>, detail::raw_type_of<W>>;
+		const std::size_t oh = shape.out_height(), ow = shape.out_width();
+		const std::size_t K = shape.in_channels * shape.kernel_height * shape.kernel_width;
+		const Fi* in = std::ranges::data(input);
+		
+		// columns[y * ow + x] is the receptive field of output (y, x), in weight order
+		std::pmr::vector<Fi> columns(oh * ow * K, scratch);
+		for (std::size_t y = 0; y < oh; y++)
+		{
+			for (std::size_t x = 0; x < ow; x++)
+			{
+				Fi* col = columns.data() + (y * ow + x) * K;
+				for (std::size_t c = 0; c < shape.in_channels; c++)
+				{
+					for (std::size_t ky = 0; ky < shape.kernel_height; ky++)
+					{
+						// unsigned wraparound makes padding positions out of range
+						const std::size_t iy = y * shape.stride_y + ky - shape.pad_y;
+						for (std::size_t kx = 0; kx < shape.kernel_width; kx++)
+						{
+							const std::size_t ix = x * shape.stride_x + kx - shape.pad_x;
+							*col++ = (iy < shape.height && ix < shape.width) ? in[(c * shape.height + iy) * shape.width + ix] : Fi();
+						}
+					}
+				}
+			}
+		}
+		detail::gemm_requantize<Acc>(columns.data(), std::ranges::data(weights), bias, rq, std::ranges::data(output),
+			oh * ow, shape.out_channels, K, 1, oh * ow);
+	}
+	
+	struct conv1d_shape
+	{
+		std::size_t in_channels, length;
+		std::size_t out_channels, kernel;
+		std::size_t stride = 1, pad = 0;
+		
+		constexpr std::size_t out_length() const { return (length + 2 * pad - kernel) / stride + 1; }
+	};
+	
+	// 1d convolution, as conv2d with height 1
+	// @param input  [in_channels][length]
+	// @param weights  [out_channels][in_channels][kernel]
+	// @param output  [out_channels][out_length]
+	template<fixed_range In, fixed_range W, fixed_range Out>
+	void conv1d(const In& input, const W& weights, std::span<const nn_accumulator_t<detail::raw_type_of<In>, detail::raw_type_of<W>>> bias,
+		std::span<const requantizer> rq, Out&& output, const conv1d_shape& shape, std::pmr::memory_resource* scratch = std::pmr::get_default_resource())
+	{
+		conv2d(input, weights, bias, rq, output, conv2d_shape{ shape.in_channels, 1, shape.length, shape.out_channels, 1, shape.kernel, 1, shape.stride, 0, shape.pad }, scratch);
+	}
+	
+	struct pool2d_shape
+	{
+		std::size_t channels, height, width;
+		std::size_t kernel, stride;
+		
+		constexpr std::size_t out_height() const { return (height - kernel) / stride + 1; }
+		constexpr std::size_t out_width() const { return (width - kernel) / stride + 1; }
+	};
+	
+	namespace detail
+	{
+		template<typename Fi, typename Fo>
+		void pool2d(const Fi* in, Fo* out, const pool2d_shape& shape, std::span<const requantizer> rq, auto init, auto combine)
+		{
+			const std::size_t oh = shape.out_height(), ow = shape.out_width();
+			for (std::size_t c = 0; c < shape.channels; c++)
+			{
+				const requantizer& r = rq[rq.size() == 1 ? 0 : c];
+				const Fi* plane = in + c * shape.height * shape.width;
+				for (std::size_t y = 0; y < oh; y++)
+				{
+					for (std::size_t x = 0; x < ow; x++)
+					{
+						auto acc = init;
+						for (std::size_t ky = 0; ky < shape.kernel; ky++)
+						{
+							for (std::size_t kx = 0; kx < shape.kernel; kx++)
+							{
+								acc = combine(acc, plane[(y * shape.stride + ky) * shape.width + x * shape.stride + kx].raw_data);
+							}
+						}
+						out[(c * oh + y) * ow + x].raw_data = r.apply<typename Fo::internal_type>(acc);
+					}
+				}
+			}
+		}
+	}
+	
+	// average pooling; the division by kernel^2 is part of the requantization,
+	// e.g. requantizer::from_ratio(2^(out_scale - in_scale) / kernel^2)
+	// @param input  [channels][height][width]
+	// @param output  [channels][out_height][out_width]
+	template<fixed_range In, fixed_range Out>
+	void avg_pool2d(const In& input, std::span<const requantizer> rq, Out&& output, const pool2d_shape& shape)
+	{
+		detail::pool2d(std::ranges::data(input), std::ranges::data(output), shape, rq, std::int32_t(0),
+			[](std::int32_t acc, auto x) { return acc + x; });
+	}
+	// max pooling, followed by requantization to the output format
+	// (requantizer::from_scales(in_scale, out_scale) for a plain format change)
+	template<fixed_range In, fixed_range Out>
+	void max_pool2d(const In& input, std::span<const requantizer> rq, Out&& output, const pool2d_shape& shape)
+	{
+		detail::pool2d(std::ranges::data(input), std::ranges::data(output), shape, rq, std::int32_t(std::numeric_limits<std::int32_t>::min()),
+			[](std::int32_t acc, auto x) { return std::max<std::int32_t>(acc, x); });
+	}
+	
+	// scale_bits of the normalized values inside layernorm, before gamma is applied
+	constexpr std::size_t layernorm_scale_bits = 16;
+	
+	// layer normalization over the last dimension
+	// mean and variance are computed exactly from 64-bit sums, and each row uses one
+	// integer reciprocal square root instead of a division per element:
+	//   z = (n * x - sum) / sqrt(n * sum_sq - sum^2 + n^2 * epsilon)
+	//   output = rq(z * gamma + beta)
+	// where z has layernorm_scale_bits and beta is raw at layernorm_scale_bits + gamma's scale_bits,
+	// e.g. rq = requantizer::from_scales(layernorm_scale_bits + gamma_scale, out_scale)
+	// @param input  [rows][n]
+	// @param gamma  [n]
+	// @param beta  [n] raw values, or empty
+	// @param epsilon  added to the variance, in units of input raw_data squared
+	// @param output  [rows][n]
+	template<fixed_range In, fixed_range G, fixed_range Out>
+	void layernorm(const In& input, const G& gamma, std::span<const std::int64_t> beta, std::span<const requantizer> rq, Out&& output,
+		std::size_t n, std::uint64_t epsilon = 1)
+	{
+		using U = std::uint64_t;
+		// reciprocal keeps this many extra bits
+		constexpr int recip_bits = 32;
+		const auto* in = std::ranges::data(input);
+		const auto* g = std::ranges::data(gamma);
+		auto* out = std::ranges::data(output);
+		const std::size_t rows = std::ranges::size(input) / n;
+		for (std::size_t row = 0; row < rows; row++)
+		{
+			const auto* x = in + row * n;
+			std::int64_t sum = 0;
+			U sum_sq = 0;
+			for (std::size_t i = 0; i < n; i++)
+			{
+				sum += x[i].raw_data;
+				sum_sq += static_cast<U>(std::int64_t(x[i].raw_data) * x[i].raw_data);
+			}
+			// n^2 * variance, exact
+			const U spread = n * sum_sq - static_cast<U>(sum * sum) + n * n * epsilon;
+			const U root = std::max<U>(detail::isqrt(spread), 1);
+			const U recip = (U(1) << (layernorm_scale_bits + recip_bits)) / root;
+			for (std::size_t i = 0; i < n; i++)
+			{
+				const std::int64_t centered = static_cast<std::int64_t>(n) * x[i].raw_data - sum;
+				// z = centered * recip >> recip_bits, on the magnitude with a 128-bit product
+				const U negate = detail::sign_mask(static_cast<U>(centered));
+				const auto [high, low] = detail::mul_wide(detail::negate_if(static_cast<U>(centered), negate), recip);
+				const std::int64_t z = static_cast<std::int64_t>(detail::negate_if((high << (64 - recip_bits)) | (low >> recip_bits), negate));
+				const std::int64_t acc = z * g[i].raw_data + (beta.empty() ? 0 : beta[i]);
+				out[row * n + i].raw_data = rq[rq.size() == 1 ? 0 : i].apply<typename std::ranges::range_value_t<Out>::internal_type>(acc);
+			}
+		}
+	}
+	
+	namespace detail
+	{
+		// evaluate a polynomial with Q30 coefficients at u (Q30), lowest degree first
+		template<std::size_t N>
+		constexpr std::int64_t poly_q30(const std::int64_t (&c)[N], std::int64_t u)
+		{
+			std::int64_t result = c[N - 1];
+			for (std::size_t i = N - 1; i-- > 0;)
+			{
+				result = ((result * u) >> 30) + c[i];
+			}
+			return result;
+		}
+		
+		// 2^-t for t >= 0 in Q16, as Q30
+		// the integer part of the exponent is a shift, and the fractional part
+		// uses a degree 5 polynomial for 2^f on [0, 1) (error about 1e-7)
+		constexpr std::uint32_t exp2_neg_q30(std::int64_t t)
+		{
+			constexpr std::int64_t coefficients[] = { std::int64_t(1) << 30, 744268966, 257850314, 59979580, 9609550, 2033403 };
+			const std::int64_t exponent = -t;
+			// floor of exponent and fraction in [0, 1)
+			const std::int64_t whole = exponent >> 16;
+			const std::int64_t frac = (exponent & 0xFFFF) << 14;
+			const std::uint64_t mantissa = static_cast<std::uint64_t>(poly_q30(coefficients, frac));
+			return static_cast<std::uint32_t>(mantissa >> std::min<std::int64_t>(-whole, 63));
+		}
+		
+		// log2(x * 2^-frac_bits) for x > 0, as Q30
+		// degree 7 polynomial for log2(1 + u) on [0, 1) (error about 4e-7)
+		constexpr std::int64_t log2_q30(std::uint64_t x, int frac_bits)
+		{
+			constexpr std::int64_t coefficients[] = { 0, 1549031010, -773433485, 506899467, -345702224, 202671709, -81230045, 15505210 };
+			const int exponent = static_cast<int>(std::bit_width(x)) - 1;
+			// x normalized to [1, 2) in Q30
+			const std::uint64_t normalized = exponent >= 30 ? x >> (exponent - 30) : x << (30 - exponent);
+			const std::int64_t u = static_cast<std::int64_t>(normalized) - (std::int64_t(1) << 30);
+			return (std::int64_t(exponent - frac_bits) << 30) + poly_q30(coefficients, u);
+		}
+		
+		// e^(x - max) as Q30 for x <= max, with x and max raw values of fixed<T, S>
+		template<std::size_t S, typename T>
+		constexpr std::uint32_t softmax_exp(T x, T max)
+		{
+			// log2(e) in Q30
+			constexpr std::uint64_t log2e = 1549082005;
+			// exponents below -64 are 0 in Q30 anyway, so the distance can be clamped
+			constexpr std::uint64_t limit = std::uint64_t(64) << 16;
+			// max - x in Q16, exact in unsigned arithmetic
+			const std::uint64_t distance = static_cast<std::uint64_t>(max) - static_cast<std::uint64_t>(x);
+			std::uint64_t distance_q16;
+			if constexpr (S >= 16)
+			{
+				distance_q16 = std::min(distance >> (S - 16), limit);
+			}
+			else
+			{
+				distance_q16 = std::min(distance, limit >> (16 - S)) << (16 - S);
+			}
+			const std::uint64_t t = (distance_q16 * log2e + (std::uint64_t(1) << 29)) >> 30;
+			return exp2_neg_q30(static_cast<std::int64_t>(t));
+		}
+		
+		template<fixed_range R>
+		constexpr auto max_raw(const R& input)
+		{
+			const auto* x = std::ranges::data(input);
+			auto result = x[0].raw_data;
+			for (std::size_t i = 1; i < std::ranges::size(input); i++)
+			{
+				result = std::max(result, x[i].raw_data);
+			}
+			return result;
+		}
+	}
+	
+	// output[i] = e^input[i] / sum_j e^input[j], with input non-empty
+	// integer only: the maximum is subtracted first, so every exponent is <= 0 and the
+	// largest term is exactly 1; exponentials are computed as 2^x with a shift and a
+	// polynomial, summed in 64 bits, and normalized with one reciprocal
+	// @param scratch  memory for one 32-bit value per element, e.g. a fixed_arena
+	template<fixed_range In, fixed_range Out>
+	void softmax(const In& input, Out&& output, std::pmr::memory_resource* scratch = std::pmr::get_default_resource())
+	{
+		using Fi = std::ranges::range_value_t<In>;
+		using Fo = std::ranges::range_value_t<Out>;
+		using raw_out = typename Fo::internal_type;
+		static_assert(Fo::fractional_bits <= 62);
+		const std::size_t n = std::ranges::size(input);
+		const Fi* x = std::ranges::data(input);
+		Fo* out = std::ranges::data(output);
+		const auto max = detail::max_raw(input);
+		
+		std::pmr::vector<std::uint32_t> terms(n, scratch);
+		std::uint64_t sum = 0;
+		for (std::size_t i = 0; i < n; i++)
+		{
+			terms[i] = detail::softmax_exp<Fi::fractional_bits>(x[i].raw_data, max);
+			sum += terms[i];
+		}
+		// sum >= 2^30, so the reciprocal fits in 33 bits and each product in 64
+		const std::uint64_t recip = (std::uint64_t(1) << 62) / sum;
+		constexpr int shift = 62 - static_cast<int>(Fo::fractional_bits);
+		// 0 when there is nothing to round (shift == 0)
+		constexpr std::uint64_t half = (std::uint64_t(1) << shift) >> 1;
+		constexpr std::uint64_t out_max = static_cast<std::uint64_t>(std::numeric_limits<raw_out>::max());
+		for (std::size_t i = 0; i < n; i++)
+		{
+			const std::uint64_t scaled = (terms[i] * recip + half) >> shift;
+			out[i].raw_data = static_cast<raw_out>(std::min(scaled, out_max));
+		}
+	}
+	
+	// log(sum_i e^input[i]) in the format of the input, with input non-empty
+	// computed as max + log(sum_i e^(input[i] - max)), so intermediate values cannot overflow
+	// (the result itself can be up to log(size) larger than the maximum input)
+	template<fixed_range In>
+	std::ranges::range_value_t<In> logsumexp(const In& input)
+	{
+		using F = std::ranges::range_value_t<In>;
+		using raw_type = typename F::internal_type;
+		// ln(2) in Q30
+		constexpr std::uint64_t ln2 = 744261118;
+		const F* x = std::ranges::data(input);
+		const auto max = detail::max_raw(input);
+		std::uint64_t sum = 0;
+		for (std::size_t i = 0; i < std::ranges::size(input); i++)
+		{
+			sum += detail::softmax_exp<F::fractional_bits>(x[i].raw_data, max);
+		}
+		// sum >= 1 in Q30, so the logarithm is non-negative
+		const std::uint64_t log2_sum = static_cast<std::uint64_t>(detail::log2_q30(sum, 30));
+		const auto [high, low] = detail::mul_wide(log2_sum, ln2);
+		const std::int64_t ln_sum = static_cast<std::int64_t>((high << 34) | (low >> 30));
+		F result;
+		if constexpr (F::fractional_bits <= 30)
+		{
+			constexpr int shift = 30 - static_cast<int>(F::fractional_bits);
+			result.raw_data = static_cast<raw_type>(max + static_cast<raw_type>((ln_sum + ((std::int64_t(1) << shift) >> 1)) >> shift));
+		}
+		else
+		{
+			result.raw_data = static_cast<raw_type>(max + static_cast<raw_type>(ln_sum << (F::fractional_bits - 30)));
+		}
+		return result;
+	}
+}
@@ -0,0 +1,253 @@
+/*
+MIT License
+
+Copyright (c) 2024 supsm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "fixed.h"
+#include "fixed_batch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+// conversion of float tensors to fixed point, and integer-only requantization
+// between layers of a quantized model
+// floats are only used when quantizing (offline or at load time);
+// requantizer::apply and requantize use integer arithmetic only
+namespace supsm
+{
+	namespace detail
+	{
+		// round to nearest (halves away from zero) and saturate to T, with NaN giving 0
+		// written without library calls so loops over it vectorize
+		template<typename T>
+		constexpr T quantize_one(float x, float scale)
+		{
+			constexpr T max = std::numeric_limits<T>::max();
+			constexpr float lo = static_cast<float>(std::numeric_limits<T>::min());
+			// largest float not above max (float(max) rounds up to 2^digits for wide T),
+			// so the conversion below never overflows; larger values select max itself
+			constexpr float hi = static_cast<float>(max - (max >> 24));
+			float scaled = x * scale;
+			scaled += scaled < 0 ? -0.5f : 0.5f;
+			const bool above = scaled >= static_cast<float>(max);
+			scaled = scaled < lo ? lo : scaled;
+			scaled = scaled > hi ? hi : scaled;
+			scaled = scaled == scaled ? scaled : 0.0f;
+			return above ? max : static_cast<T>(scaled);
+		}
+	}
+	
+	// largest scale_bits for which every value fits in T after rounding
+	// this is the most precise per-tensor format for fixed<T, scale_bits>
+	template<typename T>
+	std::size_t choose_scale_bits(std::span<const float> values)
+	{
+		float max_abs = 0;
+		for (float x : values)
+		{
+			max_abs = std::max(max_abs, std::abs(x));
+		}
+		if (max_abs == 0)
+		{
+			return std::numeric_limits<T>::digits;
+		}
+		// max_abs < 2^exponent
+		int exponent;
+		std::frexp(max_abs, &exponent);
+		int scale_bits = std::clamp(std::numeric_limits<T>::digits - exponent, 0, std::numeric_limits<T>::digits);
+		// rounding up may still need one more integer bit
+		if (scale_bits > 0 && std::round(std::ldexp(max_abs, scale_bits)) > static_cast<float>(std::numeric_limits<T>::max()))
+		{
+			scale_bits--;
+		}
+		return static_cast<std::size_t>(scale_bits);
+	}
+	// choose_scale_bits for each channel of a channel-major tensor ([channels][values / channels]),
+	// e.g. the output channels of a weight matrix
+	template<typename T>
+	std::vector<std::size_t> choose_channel_scale_bits(std::span<const float> values, std::size_t channels)
+	{
+		const std::size_t channel_size = values.size() / channels;
+		std::vector<std::size_t> result(channels);
+		for (std::size_t c = 0; c < channels; c++)
+		{
+			result[c] = choose_scale_bits<T>(values.subspan(c * channel_size, channel_size));
+		}
+		return result;
+	}
+	
+	// out[i] = in[i] in the format of `out`, rounding to nearest and saturating
+	template<fixed_range Out>
+	void quantize(std::span<const float> in, Out&& out)
+	{
+		using F = std::ranges::range_value_t<Out>;
+		const float scale = std::ldexp(1.0f, static_cast<int>(F::fractional_bits));
+		F* o = std::ranges::data(out);
+		for (std::size_t i = 0; i < in.size(); i++)
+		{
+			o[i].raw_data = detail::quantize_one<typename F::internal_type>(in[i], scale);
+		}
+	}
+	// quantize a channel-major tensor with one scale_bits per channel, storing raw values
+	// channel c of `out` then holds raw_data of fixed<T, scale_bits[c]>
+	template<typename T>
+	void quantize_channels(std::span<const float> in, std::span<const std::size_t> scale_bits, std::span<T> out)
+	{
+		const std::size_t channel_size = in.size() / scale_bits.size();
+		for (std::size_t c = 0; c < scale_bits.size(); c++)
+		{
+			const float scale = std::ldexp(1.0f, static_cast<int>(scale_bits[c]));
+			for (std::size_t i = c * channel_size; i < (c + 1) * channel_size; i++)
+			{
+				out[i] = detail::quantize_one<T>(in[i], scale);
+			}
+		}
+	}
+	// out[i] = in[i] as float
+	template<fixed_range In>
+	void dequantize(const In& in, std::span<float> out)
+	{
+		using F = std::ranges::range_value_t<In>;
+		const float scale = std::ldexp(1.0f, -static_cast<int>(F::fractional_bits));
+		const F* x = std::ranges::data(in);
+		for (std::size_t i = 0; i < out.size(); i++)
+		{
+			out[i] = static_cast<float>(x[i].raw_data) * scale;
+		}
+	}
+	
+	// integer-only multiplication of a 32-bit accumulator by a real ratio,
+	// used to move results from the accumulator's scale to the next layer's scale
+	// ratio = multiplier * 2^-shift, multiplier in [0.5, 1)
+	struct requantizer
+	{
+		fixed<std::int32_t, 31> multiplier;
+		int shift = 0;
+		
+		// computed once, offline or at load time
+		// ratio must be below 2^30; ratios below 2^-32 give a requantizer that always returns 0
+		static requantizer from_ratio(double ratio)
+		{
+			requantizer result;
+			int exponent;
+			const double mantissa = std::frexp(ratio, &exponent);
+			if (ratio <= 0 || exponent < -32)
+			{
+				return result;
+			}
+			std::int64_t m = std::llround(std::ldexp(mantissa, 31));
+			// rounding can reach 1.0
+			if (m == (std::int64_t(1) << 31))
+			{
+				m >>= 1;
+				exponent++;
+			}
+			result.multiplier.raw_data = static_cast<std::int32_t>(m);
+			result.shift = std::max(-exponent, -30);
+			return result;
+		}
+		// pure power of 2 ratio 2^-shift, e.g. between power of 2 fixed scales
+		// shifts above 33 (ratios below 2^-33) give a requantizer that always returns 0
+		// @throws std::out_of_range  if shift < -29 (ratio above 2^29)
+		static constexpr requantizer from_shift(int shift)
+		{
+			requantizer result;
+			if (shift < -29)
+			{
+				throw std::out_of_range("supsm::requantizer: shift out of range");
+			}
+			if (shift > 33)
+			{
+				return result;
+			}
+			result.multiplier.raw_data = std::int32_t(1) << 30;
+			result.shift = shift - 1;
+			return result;
+		}
+		// shift to convert an accumulator with scale acc_scale_bits (e.g. input + weight scale_bits)
+		// to scale out_scale_bits, with the range of from_shift
+		static constexpr requantizer from_scales(std::size_t acc_scale_bits, std::size_t out_scale_bits)
+		{
+			return from_shift(static_cast<int>(acc_scale_bits) - static_cast<int>(out_scale_bits));
+		}
+		
+		// round(acc * ratio) with halves rounded up (towards positive infinity), saturated to T
+		template<typename T>
+		constexpr T apply(std::int32_t acc) const
+		{
+			const int total = 31 + shift;
+			const std::int64_t product = std::int64_t(acc) * multiplier.raw_data;
+			const std::int64_t rounded = (product + (std::int64_t(1) << (total - 1))) >> total;
+			return static_cast<T>(std::clamp<std::int64_t>(rounded, std::numeric_limits<T>::min(), std::numeric_limits<T>::max()));
+		}
+		// 64-bit accumulators (e.g. from 16-bit layers) use the full 128-bit product
+		// of the magnitude, with the same rounding as above
+		template<typename T>
+		constexpr T apply(std::int64_t acc) const
+		{
+			using U = std::uint64_t;
+			const int total = 31 + shift;
+			const U negate = detail::sign_mask(static_cast<U>(acc));
+			const U magnitude = detail::negate_if(static_cast<U>(acc), negate);
+			auto [high, low] = detail::mul_wide(magnitude, static_cast<U>(multiplier.raw_data));
+			// halves of negative values must round towards zero in magnitude, so they get half - 1:
+			// -floor((m + half - 1) / 2^total) == floor((-m + half) / 2^total)
+			const U offset = (U(1) << (total - 1)) - (negate & 1);
+			low += offset;
+			high += low < offset; // carry
+			const bool overflow = (high >> total) != 0;
+			const U rounded = (high << (64 - total)) | (low >> total);
+			// largest representable magnitude with this sign
+			const U limit = negate ? U(0) - static_cast<U>(std::numeric_limits<T>::min()) : static_cast<U>(std::numeric_limits<T>::max());
+			return static_cast<T>(detail::negate_if(overflow || rounded > limit ? limit : rounded, negate));
+		}
+	};
+	
+	// out[i] = r.apply(acc[i])
+	template<typename T>
+	void requantize(std::span<const std::int32_t> acc, const requantizer& r, std::span<T> out)
+	{
+		for (std::size_t i = 0; i < out.size(); i++)
+		{
+			out[i] = r.apply<T>(acc[i]);
+		}
+	}
+	// per-channel requantization of a channels-last tensor ([rows][channels]),
+	// e.g. the output of a dense layer, where channel c uses r[c]
+	template<typename T>
+	void requantize_channels(std::span<const std::int32_t> acc, std::span<const requantizer> r, std::span<T> out)
+	{
+		for (std::size_t row = 0; row < out.size(); row += r.size())
+		{
+			for (std::size_t c = 0; c < r.size(); c++)
+			{
+				out[row + c] = r[c].apply<T>(acc[row + c]);
+			}
+		}
+	}
+}
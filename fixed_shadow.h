@@ -0,0 +1,364 @@
+/*
+MIT License
+
+Copyright (c) 2024 supsm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "fixed.h"
+
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <source_location>
+#include <string>
+
+namespace supsm
+{
+	namespace detail
+	{
+		// minimal double-double arithmetic (~106 bits of mantissa)
+		// used as the high precision reference for shadow_fixed
+		// algorithms from "Library for Double-Double and Quad-Double Arithmetic" (Hida, Li, Bailey)
+		struct double_double
+		{
+			double hi = 0, lo = 0;
+		};
+		
+		inline double_double quick_two_sum(double a, double b)
+		{
+			double s = a + b;
+			return { s, b - (s - a) };
+		}
+		inline double_double two_sum(double a, double b)
+		{
+			double s = a + b;
+			double bb = s - a;
+			return { s, (a - (s - bb)) + (b - bb) };
+		}
+		inline double_double dd_neg(double_double a) { return { -a.hi, -a.lo }; }
+		inline double_double dd_add(double_double a, double_double b)
+		{
+			double_double s = two_sum(a.hi, b.hi);
+			double_double t = two_sum(a.lo, b.lo);
+			s.lo += t.hi;
+			s = quick_two_sum(s.hi, s.lo);
+			s.lo += t.lo;
+			return quick_two_sum(s.hi, s.lo);
+		}
+		inline double_double dd_sub(double_double a, double_double b) { return dd_add(a, dd_neg(b)); }
+		inline double_double dd_mul(double_double a, double_double b)
+		{
+			double p = a.hi * b.hi;
+			double e = std::fma(a.hi, b.hi, -p);
+			e += a.hi * b.lo + a.lo * b.hi;
+			return quick_two_sum(p, e);
+		}
+		inline double_double dd_div(double_double a, double_double b)
+		{
+			// three rounds of long division, one double at a time
+			double q1 = a.hi / b.hi;
+			double_double r = dd_sub(a, dd_mul(b, { q1, 0 }));
+			double q2 = r.hi / b.hi;
+			r = dd_sub(r, dd_mul(b, { q2, 0 }));
+			double q3 = r.hi / b.hi;
+			return dd_add(quick_two_sum(q1, q2), { q3, 0 });
+		}
+		inline double_double dd_trunc(double_double a)
+		{
+			// floor for positive, ceil for negative
+			auto round_fn = [neg = a.hi < 0](double x) { return neg ? std::ceil(x) : std::floor(x); };
+			double hi = round_fn(a.hi);
+			if (hi != a.hi)
+			{
+				return { hi, 0 };
+			}
+			return quick_two_sum(hi, round_fn(a.lo));
+		}
+		inline double_double dd_ldexp(double_double a, int exp) { return { std::ldexp(a.hi, exp), std::ldexp(a.lo, exp) }; }
+		inline double dd_abs_diff(double_double a, double_double b)
+		{
+			double_double d = dd_sub(a, b);
+			return std::abs(d.hi + d.lo);
+		}
+		
+		// exact conversion of an integer (up to 64 bits) to double-double
+		template<typename T>
+		double_double int_to_dd(T x)
+		{
+			static_assert(std::numeric_limits<T>::digits <= 64, "shadow_fixed supports underlying types up to 64 bits");
+			using wide_type = std::conditional_t<std::is_signed_v<T>, std::int64_t, std::uint64_t>;
+			const wide_type w = x;
+			// both halves fit exactly in a double
+			const double high = static_cast<double>(w >> 32) * 4294967296.0;
+			const double low = static_cast<double>(static_cast<std::uint32_t>(w));
+			return two_sum(high, low);
+		}
+	}
+	
+	// error statistics collected by shadow_fixed
+	struct shadow_stats
+	{
+		std::size_t count = 0;
+		double max_error = 0;
+		double total_error = 0;
+		
+		double mean_error() const { return count == 0 ? 0 : total_error / count; }
+	};
+	
+	// process-wide collection of shadow_fixed error statistics
+	// call sites record the rounding error introduced by a single operation
+	// variables record the error accumulated since the value was last exact
+	class shadow_registry
+	{
+		public:
+		static shadow_registry& instance()
+		{
+			static shadow_registry registry;
+			return registry;
+		}
+		
+		// sites are keyed by location and operator, since compilers may give every operator
+		// of an expression (e.g. both in `total += price * rate`) the same location
+		void record_site(const std::source_location& loc, const char* op, double error)
+		{
+			std::string key = std::string(loc.file_name()) + ':' + std::to_string(loc.line()) + ':' + std::to_string(loc.column()) + " (" + op + ')';
+			std::lock_guard lock(mutex);
+			add(sites[key], error);
+		}
+		void record_variable(const char* name, double error)
+		{
+			std::lock_guard lock(mutex);
+			add(variables[name], error);
+		}
+		
+		std::map<std::string, shadow_stats> site_stats() const { std::lock_guard lock(mutex); return sites; }
+		std::map<std::string, shadow_stats> variable_stats() const { std::lock_guard lock(mutex); return variables; }
+		void reset() { std::lock_guard lock(mutex); sites.clear(); variables.clear(); }
+		
+		// print one line per call site and variable:
+		// <name> count=<n> max=<max error> mean=<mean error>
+		void report(std::ostream& os) const
+		{
+			std::lock_guard lock(mutex);
+			auto print = [&os](const auto& entries)
+			{
+				for (const auto& [name, stats] : entries)
+				{
+					os << "  " << name << " count=" << stats.count << " max=" << stats.max_error << " mean=" << stats.mean_error() << '\n';
+				}
+			};
+			os << "call sites:\n";
+			print(sites);
+			os << "variables:\n";
+			print(variables);
+		}
+		
+		private:
+		static void add(shadow_stats& stats, double error)
+		{
+			stats.count++;
+			stats.total_error += error;
+			if (error > stats.max_error)
+			{
+				stats.max_error = error;
+			}
+		}
+		
+		mutable std::mutex mutex;
+		std::map<std::string, shadow_stats> sites;
+		std::map<std::string, shadow_stats> variables;
+	};
+	
+	namespace detail
+	{
+		// operand wrapper that captures the source location of the expression using it
+		// operators cannot have default arguments, but constructors of their parameters can
+		template<typename F>
+		struct shadow_operand
+		{
+			F value;
+			std::source_location loc;
+			
+			shadow_operand(const F& val, std::source_location loc = std::source_location::current()) : value(val), loc(loc) {}
+			shadow_operand(detail::integer_or_T<typename F::internal_type> auto int_val, std::source_location loc = std::source_location::current()) : value(int_val), loc(loc) {}
+		};
+	}
+	
+	// debugging drop-in replacement for fixed
+	// carries a double-double shadow value through every operation and
+	// records error statistics in shadow_registry, which can be used to
+	// determine whether T and scale_bits give sufficient precision
+	// bitwise operators are not provided since they have no real-valued counterpart
+	// @tparam T, scale_bits, fast_multdiv, multdiv_cast_type  see fixed
+	template<typename T, std::size_t scale_bits, bool fast_multdiv = false, typename multdiv_cast_type = T>
+	class shadow_fixed
+	{
+		using operand = detail::shadow_operand<shadow_fixed>;
+		enum operation { plus, minus, times, divide, modulo };
+		
+		public:
+		using fixed_type = fixed<T, scale_bits, fast_multdiv, multdiv_cast_type>;
+		using internal_type = T;
+		
+		fixed_type value;
+		detail::double_double shadow;
+		
+		shadow_fixed() = default;
+		shadow_fixed(detail::integer_or_T<T> auto int_val) : value(int_val), shadow(exact(value)) {}
+		shadow_fixed(detail::integer_or_T<T> auto int_val, std::size_t scale) : value(int_val, scale), shadow(exact(value)) {}
+		shadow_fixed(const fixed_type& val) : value(val), shadow(exact(value)) {}
+		// copies do not inherit the tracked name
+		shadow_fixed(const shadow_fixed& other) : value(other.value), shadow(other.shadow) {}
+		// assigning keeps the tracked name, and records accumulated error if tracked
+		shadow_fixed& operator=(const shadow_fixed& other)
+		{
+			value = other.value;
+			shadow = other.shadow;
+			record_variable();
+			return *this;
+		}
+		
+		// record accumulated error of this variable under `var_name` on every assignment
+		// `var_name` must outlive this object
+		shadow_fixed& track(const char* var_name) { name = var_name; record_variable(); return *this; }
+		
+		// absolute difference between fixed point value and shadow value
+		double error() const { return detail::dd_abs_diff(exact(value), shadow); }
+		double shadow_value() const { return shadow.hi + shadow.lo; }
+		
+		template<std::integral T2>
+		explicit operator T2() const { return static_cast<T2>(value); }
+		explicit operator float() const { return static_cast<float>(value); }
+		explicit operator double() const { return static_cast<double>(value); }
+		explicit operator fixed_type() const { return value; }
+		
+		shadow_fixed operator+() const { return *this; }
+		shadow_fixed operator-() const { shadow_fixed result; result.value = -value; result.shadow = detail::dd_neg(shadow); return result; }
+		shadow_fixed operator+(operand other) const { shadow_fixed result = *this; result.apply(other, plus, "+"); return result; }
+		shadow_fixed operator-(operand other) const { shadow_fixed result = *this; result.apply(other, minus, "-"); return result; }
+		shadow_fixed operator*(operand other) const { shadow_fixed result = *this; result.apply(other, times, "*"); return result; }
+		shadow_fixed operator/(operand other) const { shadow_fixed result = *this; result.apply(other, divide, "/"); return result; }
+		shadow_fixed operator%(operand other) const { shadow_fixed result = *this; result.apply(other, modulo, "%"); return result; }
+		shadow_fixed operator<<(detail::integer_or_T<T> auto amt) const { shadow_fixed result = *this; result <<= amt; return result; }
+		shadow_fixed operator>>(detail::integer_or_T<T> auto amt) const { shadow_fixed result = *this; result >>= amt; return result; }
+		
+		shadow_fixed& operator+=(operand other) { apply(other, plus, "+="); record_variable(); return *this; }
+		shadow_fixed& operator-=(operand other) { apply(other, minus, "-="); record_variable(); return *this; }
+		shadow_fixed& operator*=(operand other) { apply(other, times, "*="); record_variable(); return *this; }
+		shadow_fixed& operator/=(operand other) { apply(other, divide, "/="); record_variable(); return *this; }
+		shadow_fixed& operator%=(operand other) { apply(other, modulo, "%="); record_variable(); return *this; }
+		shadow_fixed& operator<<=(detail::integer_or_T<T> auto amt)
+		{
+			value <<= amt;
+			shadow = detail::dd_ldexp(shadow, static_cast<int>(amt));
+			record_variable();
+			return *this;
+		}
+		shadow_fixed& operator>>=(detail::integer_or_T<T> auto amt)
+		{
+			value >>= amt;
+			shadow = detail::dd_ldexp(shadow, -static_cast<int>(amt));
+			record_variable();
+			return *this;
+		}
+		
+		friend shadow_fixed operator+(detail::integer_or_T<T> auto left, operand right) { shadow_fixed result; result.apply_integer(left, right, plus, "+"); return result; }
+		friend shadow_fixed operator-(detail::integer_or_T<T> auto left, operand right) { shadow_fixed result; result.apply_integer(left, right, minus, "-"); return result; }
+		friend shadow_fixed operator*(detail::integer_or_T<T> auto left, operand right) { shadow_fixed result; result.apply_integer(left, right, times, "*"); return result; }
+		friend shadow_fixed operator/(detail::integer_or_T<T> auto left, operand right) { shadow_fixed result; result.apply_integer(left, right, divide, "/"); return result; }
+		friend shadow_fixed operator%(detail::integer_or_T<T> auto left, operand right) { shadow_fixed result; result.apply_integer(left, right, modulo, "%"); return result; }
+		
+		// comparisons use the fixed point value so control flow matches fixed
+		std::strong_ordering operator<=>(const shadow_fixed& other) const { return value <=> other.value; }
+		bool operator==(const shadow_fixed& other) const { return value == other.value; }
+		template<detail::comparable_integer I> requires detail::comparable_integer<T>
+		std::strong_ordering operator<=>(I other) const { return value <=> other; }
+		template<detail::comparable_integer I> requires detail::comparable_integer<T>
+		bool operator==(I other) const { return value == other; }
+		
+		private:
+		const char* name = nullptr;
+		
+		static detail::double_double exact(const fixed_type& val)
+		{
+			return detail::dd_ldexp(detail::int_to_dd(val.raw_data), -static_cast<int>(scale_bits));
+		}
+		static detail::double_double eval(detail::double_double a, detail::double_double b, operation op)
+		{
+			switch (op)
+			{
+			case plus: return detail::dd_add(a, b);
+			case minus: return detail::dd_sub(a, b);
+			case times: return detail::dd_mul(a, b);
+			case divide: return detail::dd_div(a, b);
+			case modulo: return detail::dd_sub(a, detail::dd_mul(detail::dd_trunc(detail::dd_div(a, b)), b));
+			}
+			return {};
+		}
+		
+		// @param symbol  operator as written, e.g. "*" or "+="
+		void apply(const operand& other, operation op, const char* symbol)
+		{
+			const fixed_type& b = other.value.value;
+			// error introduced by this operation alone, using the exact operands
+			const detail::double_double local = eval(exact(value), exact(b), op);
+			shadow = eval(shadow, other.value.shadow, op);
+			switch (op)
+			{
+			case plus: value += b; break;
+			case minus: value -= b; break;
+			case times: value *= b; break;
+			case divide: value /= b; break;
+			case modulo: value %= b; break;
+			}
+			shadow_registry::instance().record_site(other.loc, symbol, detail::dd_abs_diff(exact(value), local));
+		}
+		// integer (left) op other, computed by fixed's own integer operators,
+		// with the shadow starting from the exact integer
+		template<typename I>
+		void apply_integer(I left, const operand& other, operation op, const char* symbol)
+		{
+			const fixed_type& b = other.value.value;
+			const detail::double_double exact_left = detail::int_to_dd(left);
+			const detail::double_double local = eval(exact_left, exact(b), op);
+			shadow = eval(exact_left, other.value.shadow, op);
+			switch (op)
+			{
+			case plus: value = left + b; break;
+			case minus: value = left - b; break;
+			case times: value = left * b; break;
+			case divide: value = left / b; break;
+			case modulo: value = left % b; break;
+			}
+			shadow_registry::instance().record_site(other.loc, symbol, detail::dd_abs_diff(exact(value), local));
+		}
+		void record_variable() const
+		{
+			if (name != nullptr)
+			{
+				shadow_registry::instance().record_variable(name, error());
+			}
+		}
+	};
+}
@@ -0,0 +1,156 @@
+/*
+MIT License
+
+Copyright (c) 2024 supsm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "fixed.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+
+namespace supsm
+{
+	// relative cost of each candidate format, indexed by width (8, 16, 32, 64 bits)
+	// defaults are rough estimates; for best results, replace them with
+	// timings of fixed operations measured on the target machine
+	struct format_costs
+	{
+		double per_byte = 1; // memory traffic per byte of storage
+		std::array<double, 4> mul = { 2, 2, 3, 6 };
+		std::array<double, 4> mul_fast = { 1, 1, 1, 1 };
+		std::array<double, 4> div = { 10, 18, 34, 66 };
+		std::array<double, 4> div_fast = { 4, 4, 6, 10 };
+	};
+	
+	// what the chosen format must satisfy
+	struct format_requirements
+	{
+		// maximum absolute error when converting a sample to fixed point (round to nearest)
+		double tolerance;
+		// extra integer bits to reserve for intermediate results (e.g. sums)
+		std::size_t headroom_bits = 0;
+		// expected operations per element, used to weigh mult/div cost against memory
+		double muls_per_element = 1;
+		double divs_per_element = 0;
+	};
+	
+	// a recommended fixed<T, scale_bits, fast_multdiv> configuration
+	struct format_recommendation
+	{
+		std::size_t bits; // total bits of T
+		bool is_signed;
+		std::size_t scale_bits;
+		// whether multiplying or dividing any two samples is safe with fast_multdiv
+		bool fast_multdiv;
+		// maximum conversion error observed over the samples
+		double max_error;
+		double cost;
+		
+		// e.g. "fixed<int16_t, 8, true>"
+		std::string name() const
+		{
+			return std::string("fixed<") + (is_signed ? "" : "u") + "int" + std::to_string(bits) + "_t, " + std::to_string(scale_bits) + (fast_multdiv ? ", true>" : ">");
+		}
+	};
+	
+	// recommend the cheapest fixed point format that represents every sample
+	// within the requested tolerance
+	// @param samples  representative values the format must hold
+	// @return  std::nullopt if no format of up to 64 bits is sufficient, or if a sample is not finite
+	inline std::optional<format_recommendation> recommend_format(std::span<const double> samples, const format_requirements& req, const format_costs& costs = {})
+	{
+		double max_abs = 0;
+		bool is_signed = false;
+		for (double x : samples)
+		{
+			if (!std::isfinite(x))
+			{
+				return std::nullopt;
+			}
+			max_abs = std::max(max_abs, std::abs(x));
+			is_signed |= x < 0;
+		}
+		// integer bits needed to hold the largest magnitude
+		const std::size_t int_bits = static_cast<std::size_t>(std::max(0, std::ilogb(max_abs) + 1)) + req.headroom_bits;
+		
+		std::optional<format_recommendation> best;
+		constexpr std::array<std::size_t, 4> widths = { 8, 16, 32, 64 };
+		for (std::size_t w = 0; w < widths.size(); w++)
+		{
+			const std::size_t digits = widths[w] - is_signed;
+			if (int_bits > digits)
+			{
+				continue;
+			}
+			// smallest scale satisfying the tolerance is the cheapest, since
+			// it leaves the most headroom for fast_multdiv
+			// rounded raw values must fit in T, less the headroom
+			const double raw_max = std::ldexp(1.0, static_cast<int>(digits - req.headroom_bits));
+			const double raw_min = is_signed ? -raw_max : 0;
+			std::optional<std::size_t> scale;
+			double error = 0, max_raw = 0;
+			for (std::size_t s = 0; s <= digits - int_bits; s++)
+			{
+				error = 0;
+				max_raw = 0;
+				bool fits = true;
+				for (double x : samples)
+				{
+					const double scaled = std::ldexp(x, static_cast<int>(s));
+					const double rounded = std::nearbyint(scaled);
+					// values just below a power of 2 can round up past the range
+					fits &= rounded < raw_max && rounded >= raw_min;
+					max_raw = std::max(max_raw, std::abs(rounded));
+					error = std::max(error, std::ldexp(std::abs(scaled - rounded), -static_cast<int>(s)));
+				}
+				if (fits && error <= req.tolerance)
+				{
+					scale = s;
+					break;
+				}
+			}
+			if (!scale)
+			{
+				continue;
+			}
+			// fast multiplication needs raw products to fit in T,
+			// fast division needs the dividend shifted by scale_bits to fit in T
+			const std::size_t rounded_bits = max_raw == 0 ? 0 : static_cast<std::size_t>(std::ilogb(max_raw) + 1);
+			const std::size_t raw_bits = std::max(int_bits + *scale, rounded_bits + req.headroom_bits);
+			const bool fast = 2 * raw_bits <= digits && (req.divs_per_element == 0 || raw_bits + *scale <= digits);
+			const double cost = costs.per_byte * static_cast<double>(widths[w] / 8) +
+				req.muls_per_element * (fast ? costs.mul_fast[w] : costs.mul[w]) +
+				req.divs_per_element * (fast ? costs.div_fast[w] : costs.div[w]);
+			if (!best || cost < best->cost)
+			{
+				best = format_recommendation{ widths[w], is_signed, *scale, fast, error, cost };
+			}
+		}
+		return best;
+	}
+}
@@ -0,0 +1,242 @@
+/*
+MIT License
+
+Copyright (c) 2024 supsm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "fixed.h"
+#include "fixed_batch.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+namespace supsm
+{
+	// contiguous container of fixed with storage suitable for unmasked vector loads:
+	// - data() is aligned to `alignment` bytes
+	// - storage is padded to a multiple of `block_size` elements, and
+	//   padding elements in [size(), padded_size()) are always 0
+	// memory is obtained from a std::pmr::memory_resource, which must support `alignment`
+	// element-wise operators use the kernels in fixed_batch.h
+	// @tparam F  fixed type to store
+	template<typename F>
+	class fixed_vector
+	{
+		static_assert(is_fixed_v<F>);
+		// required for raw()
+		static_assert(sizeof(F) == sizeof(typename F::internal_type) && std::is_standard_layout_v<F>);
+		
+		public:
+		using value_type = F;
+		using internal_type = typename F::internal_type;
+		using size_type = std::size_t;
+		using difference_type = std::ptrdiff_t;
+		using reference = F&;
+		using const_reference = const F&;
+		using pointer = F*;
+		using const_pointer = const F*;
+		using iterator = F*;
+		using const_iterator = const F*;
+		
+		static constexpr std::size_t alignment = 64;
+		static constexpr std::size_t block_size = std::max<std::size_t>(alignment / sizeof(F), 1);
+		
+		fixed_vector() : fixed_vector(std::pmr::get_default_resource()) {}
+		explicit fixed_vector(std::pmr::memory_resource* resource) : resource(resource) {}
+		// n copies of value
+		explicit fixed_vector(size_type n, F value = F(), std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : resource(resource)
+		{
+			resize(n, value);
+		}
+		fixed_vector(std::initializer_list<F> values, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : resource(resource)
+		{
+			assign(values.begin(), values.end());
+		}
+		fixed_vector(const fixed_vector& other) : resource(other.resource)
+		{
+			assign(other.begin(), other.end());
+		}
+		fixed_vector(fixed_vector&& other) noexcept :
+			resource(other.resource),
+			ptr(std::exchange(other.ptr, nullptr)),
+			count(std::exchange(other.count, 0)),
+			cap(std::exchange(other.cap, 0)) {}
+		~fixed_vector() { deallocate(); }
+		
+		fixed_vector& operator=(const fixed_vector& other)
+		{
+			if (this != &other)
+			{
+				assign(other.begin(), other.end());
+			}
+			return *this;
+		}
+		// memory resources are not propagated; if they differ, elements are copied
+		fixed_vector& operator=(fixed_vector&& other)
+		{
+			if (this == &other)
+			{
+				return *this;
+			}
+			if (resource->is_equal(*other.resource))
+			{
+				deallocate();
+				ptr = std::exchange(other.ptr, nullptr);
+				count = std::exchange(other.count, 0);
+				cap = std::exchange(other.cap, 0);
+			}
+			else
+			{
+				assign(other.begin(), other.end());
+			}
+			return *this;
+		}
+		
+		// replace contents with [first, last)
+		void assign(const F* first, const F* last)
+		{
+			const size_type n = static_cast<size_type>(last - first);
+			clear();
+			reserve(n);
+			std::copy(first, last, ptr);
+			count = n;
+		}
+		
+		size_type size() const { return count; }
+		// size rounded up to a multiple of block_size
+		size_type padded_size() const { return round_up(count); }
+		size_type capacity() const { return cap; }
+		bool empty() const { return count == 0; }
+		std::pmr::memory_resource* get_memory_resource() const { return resource; }
+		
+		F* data() { return ptr; }
+		const F* data() const { return ptr; }
+		iterator begin() { return ptr; }
+		iterator end() { return ptr + count; }
+		const_iterator begin() const { return ptr; }
+		const_iterator end() const { return ptr + count; }
+		F& operator[](size_type i) { return ptr[i]; }
+		const F& operator[](size_type i) const { return ptr[i]; }
+		
+		// elements including zero padding, for whole-block loops
+		std::span<F> padded() { return { ptr, padded_size() }; }
+		std::span<const F> padded() const { return { ptr, padded_size() }; }
+		// underlying raw_data of the elements, e.g. for reading or writing files directly
+		std::span<internal_type> raw() { return { reinterpret_cast<internal_type*>(ptr), count }; }
+		std::span<const internal_type> raw() const { return { reinterpret_cast<const internal_type*>(ptr), count }; }
+		
+		void reserve(size_type n)
+		{
+			if (n <= cap)
+			{
+				return;
+			}
+			const size_type new_cap = round_up(std::max(n, cap * 2));
+			F* new_ptr = static_cast<F*>(resource->allocate(new_cap * sizeof(F), alignment));
+			std::uninitialized_value_construct_n(new_ptr, new_cap);
+			if (ptr != nullptr)
+			{
+				std::copy(ptr, ptr + count, new_ptr);
+			}
+			deallocate();
+			ptr = new_ptr;
+			cap = new_cap;
+		}
+		void resize(size_type n, F value = F())
+		{
+			reserve(n);
+			if (n > count)
+			{
+				std::fill(ptr + count, ptr + n, value);
+			}
+			else
+			{
+				// restore zero padding
+				std::fill(ptr + n, ptr + count, F());
+			}
+			count = n;
+		}
+		void push_back(F value)
+		{
+			reserve(count + 1);
+			ptr[count++] = value;
+		}
+		void pop_back() { ptr[--count] = F(); }
+		void clear() { resize(0); }
+		
+		// @throws std::invalid_argument  if other.size() != size()
+		fixed_vector& operator+=(const fixed_vector& other) { check_size(other); add(padded(), other.padded(), padded()); return *this; }
+		fixed_vector& operator-=(const fixed_vector& other) { check_size(other); sub(padded(), other.padded(), padded()); return *this; }
+		fixed_vector& operator*=(const fixed_vector& other) { check_size(other); mul(padded(), other.padded(), padded()); return *this; }
+		// padding is excluded since it would divide by 0
+		fixed_vector& operator/=(const fixed_vector& other) { check_size(other); div(*this, other, *this); return *this; }
+		// scalar operations exclude padding to keep it 0
+		fixed_vector& operator+=(F other) { add(*this, other, *this); return *this; }
+		fixed_vector& operator-=(F other) { sub(*this, other, *this); return *this; }
+		fixed_vector& operator*=(F other) { mul(*this, other, *this); return *this; }
+		fixed_vector& operator/=(F other) { div(*this, other, *this); return *this; }
+		
+		// both operands must have the same size
+		// @throws std::invalid_argument  if they do not
+		friend fixed_vector operator+(fixed_vector left, const fixed_vector& right) { left += right; return left; }
+		friend fixed_vector operator-(fixed_vector left, const fixed_vector& right) { left -= right; return left; }
+		friend fixed_vector operator*(fixed_vector left, const fixed_vector& right) { left *= right; return left; }
+		friend fixed_vector operator/(fixed_vector left, const fixed_vector& right) { left /= right; return left; }
+		friend fixed_vector operator+(fixed_vector left, F right) { left += right; return left; }
+		friend fixed_vector operator-(fixed_vector left, F right) { left -= right; return left; }
+		friend fixed_vector operator*(fixed_vector left, F right) { left *= right; return left; }
+		friend fixed_vector operator/(fixed_vector left, F right) { left /= right; return left; }
+		
+		friend bool operator==(const fixed_vector& left, const fixed_vector& right) { return std::ranges::equal(left, right); }
+		
+		private:
+		static size_type round_up(size_type n) { return (n + block_size - 1) / block_size * block_size; }
+		// element-wise operators would read past the end of a shorter operand
+		void check_size(const fixed_vector& other) const
+		{
+			if (other.count != count)
+			{
+				throw std::invalid_argument("supsm::fixed_vector: operand sizes differ");
+			}
+		}
+		void deallocate()
+		{
+			if (ptr != nullptr)
+			{
+				resource->deallocate(ptr, cap * sizeof(F), alignment);
+				ptr = nullptr;
+				cap = 0;
+			}
+		}
+		
+		std::pmr::memory_resource* resource;
+		F* ptr = nullptr;
+		size_type count = 0;
+		size_type cap = 0;
+	};
+}
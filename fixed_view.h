@@ -0,0 +1,179 @@
+/*
+MIT License
+
+Copyright (c) 2024 supsm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "fixed.h"
+#include "fixed_batch.h"
+
+#include <concepts>
+#include <cstddef>
+#include <span>
+#include <tuple>
+#include <utility>
+
+namespace supsm
+{
+	namespace detail
+	{
+		template<typename V>
+		constexpr auto apply_stages(V value) { return value; }
+		template<typename V, typename Stage, typename... Rest>
+		constexpr auto apply_stages(V value, const Stage& stage, const Rest&... rest) { return apply_stages(stage(value), rest...); }
+	}
+	
+	// lazy element-wise pipeline over a contiguous range of fixed
+	// stages are appended with operator| and nothing is computed until the view is
+	// materialized, at which point all stages run in a single pass over the source
+	// the source range must outlive the view
+	// @tparam F  element type of the source
+	// @tparam Stages  callables applied to each element in order; see supsm::views
+	template<typename F, typename... Stages>
+	class fixed_view
+	{
+		public:
+		using source_type = F;
+		// element type after all stages
+		using value_type = decltype(detail::apply_stages(std::declval<F>(), std::declval<const Stages&>()...));
+		
+		constexpr explicit fixed_view(std::span<const F> source, Stages... stages) : source(source), stages(std::move(stages)...) {}
+		constexpr explicit fixed_view(const fixed_range auto& source) : source(source) {}
+		
+		constexpr std::size_t size() const { return source.size(); }
+		constexpr value_type operator[](std::size_t i) const
+		{
+			return std::apply([this, i](const auto&... s) { return detail::apply_stages(source[i], s...); }, stages);
+		}
+		
+		// write all elements to `out`, which must have size() elements
+		template<typename Out>
+			requires std::ranges::contiguous_range<Out> && std::same_as<std::ranges::range_value_t<Out>, value_type>
+		constexpr void materialize(Out&& out) const
+		{
+			auto* o = std::ranges::data(out);
+			const F* x = source.data();
+			const std::size_t n = source.size();
+			// unpack stages outside the loop so the body is a single fused expression
+			std::apply([o, x, n](const auto&... s)
+			{
+				for (std::size_t i = 0; i < n; i++)
+				{
+					o[i] = detail::apply_stages(x[i], s...);
+				}
+			}, stages);
+		}
+		// materialize into a new container, e.g. std::vector or fixed_vector
+		template<typename Container>
+		Container to() const
+		{
+			Container result(size());
+			materialize(result);
+			return result;
+		}
+		
+		template<std::invocable<value_type> Stage>
+		constexpr friend fixed_view<F, Stages..., Stage> operator|(const fixed_view& view, Stage stage)
+		{
+			return std::apply([&](const auto&... s) { return fixed_view<F, Stages..., Stage>(view.source, s..., std::move(stage)); }, view.stages);
+		}
+		
+		private:
+		template<typename, typename...>
+		friend class fixed_view;
+		
+		std::span<const F> source;
+		std::tuple<Stages...> stages;
+	};
+	
+	template<fixed_range R>
+	fixed_view(const R&) -> fixed_view<std::ranges::range_value_t<R>>;
+	
+	// stages for fixed_view
+	namespace views
+	{
+		template<typename F>
+		struct add_stage
+		{
+			F amount;
+			constexpr F operator()(F x) const { return x + amount; }
+		};
+		template<typename F>
+		struct sub_stage
+		{
+			F amount;
+			constexpr F operator()(F x) const { return x - amount; }
+		};
+		template<typename F>
+		struct mul_stage
+		{
+			F factor;
+			constexpr F operator()(F x) const { return x * factor; }
+		};
+		template<typename F>
+		struct div_stage
+		{
+			F divisor;
+			constexpr F operator()(F x) const { return x / divisor; }
+		};
+		template<typename F>
+		struct clamp_stage
+		{
+			F lo, hi;
+			constexpr F operator()(F x) const { return supsm::clamp(x, lo, hi); }
+		};
+		template<typename To>
+		struct convert_stage
+		{
+			template<typename From>
+			constexpr To operator()(From x) const { return fixed_cast<To>(x); }
+		};
+		template<typename Fn>
+		struct transform_stage
+		{
+			Fn fn;
+			constexpr auto operator()(auto x) const { return fn(x); }
+		};
+		
+		// x + amount
+		template<typename F>
+		constexpr add_stage<F> add(F amount) { return { amount }; }
+		// x - amount
+		template<typename F>
+		constexpr sub_stage<F> sub(F amount) { return { amount }; }
+		// x * factor
+		template<typename F>
+		constexpr mul_stage<F> mul(F factor) { return { factor }; }
+		// x / divisor
+		template<typename F>
+		constexpr div_stage<F> div(F divisor) { return { divisor }; }
+		// x limited to [lo, hi]
+		template<typename F>
+		constexpr clamp_stage<F> clamp(F lo, F hi) { return { lo, hi }; }
+		// fixed_cast<To>(x)
+		template<typename To>
+		constexpr convert_stage<To> convert() { return {}; }
+		// fn(x)
+		template<typename Fn>
+		constexpr transform_stage<Fn> transform(Fn fn) { return { std::move(fn) }; }
+	}
+}
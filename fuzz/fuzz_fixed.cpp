@@ -0,0 +1,543 @@
+/*
+MIT License
+
+Copyright (c) 2024 supsm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// differential fuzz target for fixed.h
+// random raw_data and format choices go through every operator, the constructors and conversions,
+// fixed_cast, the rounding functions, the branch-free helpers, reciprocal, product, mul_wide,
+// mul_high/mul_low and divmod, and every result is compared against an exact reference
+// computed with __int128 and a small multiword integer
+// formats cover 8, 16, 32 and 64 bit signed and unsigned T, with scale_bits 0, half and all but one bit
+//
+// with libFuzzer (from the repository root):
+//   clang++ -std=c++20 -O1 -g -fsanitize=fuzzer,address,undefined -fno-sanitize-recover=all -I. fuzz/fuzz_fixed.cpp -o fuzz_fixed
+//   ./fuzz_fixed
+// without libFuzzer, FUZZ_STANDALONE adds a main that runs random inputs:
+//   g++ -std=c++20 -O1 -g -fsanitize=address,undefined -DFUZZ_STANDALONE -I. fuzz/fuzz_fixed.cpp -o fuzz_fixed
+//   ./fuzz_fixed [iterations]
+
+#include "fixed.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(FUZZ_STANDALONE)
+#include <random>
+#include <string>
+#include <vector>
+#endif
+
+namespace
+{
+	__extension__ typedef unsigned __int128 u128;
+	__extension__ typedef __int128 i128;
+	
+	template<typename T>
+	using unsigned_t = std::make_unsigned_t<T>;
+	template<typename T>
+	constexpr std::size_t width = std::numeric_limits<unsigned_t<T>>::digits;
+	// true if arithmetic on T happens in int, so overflow wraps on conversion back instead of being undefined
+	template<typename T>
+	constexpr bool wraps = std::is_unsigned_v<T> || sizeof(T) < sizeof(int);
+	
+	// fuzzer bytes, read as values; runs out into zeros
+	class input
+	{
+		const std::uint8_t* data;
+		std::size_t size;
+		
+		public:
+		input(const std::uint8_t* data, std::size_t size) : data(data), size(size) {}
+		
+		bool empty() const { return size == 0; }
+		
+		std::uint8_t byte()
+		{
+			if (size == 0)
+			{
+				return 0;
+			}
+			size--;
+			return *data++;
+		}
+		// a value of T, biased towards the edge cases of T
+		template<typename T>
+		T value()
+		{
+			switch (byte() % 8)
+			{
+				case 0: return T(0);
+				case 1: return T(1);
+				case 2: return static_cast<T>(-1);
+				case 3: return std::numeric_limits<T>::min();
+				case 4: return std::numeric_limits<T>::max();
+				default:
+				{
+					unsigned_t<T> bits = 0;
+					for (std::size_t i = 0; i < sizeof(T); i++)
+					{
+						bits = static_cast<unsigned_t<T>>(bits << 4 << 4) | byte();
+					}
+					return static_cast<T>(bits);
+				}
+			}
+		}
+	};
+	
+	// x as a two's complement 128-bit value
+	template<typename T>
+	u128 extend(T x)
+	{
+		return static_cast<u128>(static_cast<i128>(x));
+	}
+	// |x|, and whether x is negative
+	template<typename T>
+	u128 magnitude(T x)
+	{
+		return x < 0 ? u128(0) - extend(x) : extend(x);
+	}
+	// low bits of x as T
+	template<typename T>
+	T wrap(u128 x)
+	{
+		return static_cast<T>(static_cast<unsigned_t<T>>(x));
+	}
+	
+	// little endian 256-bit unsigned integer, enough for any product or shifted dividend below
+	struct big
+	{
+		std::uint64_t words[4] = {};
+		
+		// x * 2^shift, x < 2^64, shift < 192
+		static big shifted(u128 x, std::size_t shift)
+		{
+			big result;
+			const std::size_t word = shift / 64, bit = shift % 64;
+			result.words[word] = static_cast<std::uint64_t>(x << bit);
+			result.words[word + 1] = bit == 0 ? 0 : static_cast<std::uint64_t>(x >> (64 - bit));
+			return result;
+		}
+		big& operator*=(std::uint64_t factor)
+		{
+			u128 carry = 0;
+			for (std::uint64_t& w : words)
+			{
+				const u128 product = static_cast<u128>(w) * factor + carry;
+				w = static_cast<std::uint64_t>(product);
+				carry = product >> 64;
+			}
+			return *this;
+		}
+		big& operator/=(std::uint64_t divisor)
+		{
+			u128 remainder = 0;
+			for (std::size_t i = 4; i-- > 0;)
+			{
+				const u128 current = (remainder << 64) | words[i];
+				words[i] = static_cast<std::uint64_t>(current / divisor);
+				remainder = current % divisor;
+			}
+			return *this;
+		}
+		// bits [shift, shift + 64)
+		std::uint64_t bits(std::size_t shift) const
+		{
+			const std::size_t word = shift / 64, bit = shift % 64;
+			const std::uint64_t high = word + 1 < 4 && bit != 0 ? words[word + 1] << (64 - bit) : 0;
+			return (words[word] >> bit) | high;
+		}
+		// value < 2^bits, bits <= 64
+		bool below(std::size_t bits) const
+		{
+			return words[1] == 0 && words[2] == 0 && words[3] == 0 && (bits == 64 || (words[0] >> bits) == 0);
+		}
+	};
+	
+	[[noreturn]] void fail(const char* what, const char* type, std::size_t scale, u128 a, u128 b, u128 expected, u128 actual)
+	{
+		std::fprintf(stderr, "%s on fixed<%s, %zu>: a=%016llx b=%016llx expected=%016llx actual=%016llx\n", what, type, scale,
+			static_cast<unsigned long long>(a), static_cast<unsigned long long>(b), static_cast<unsigned long long>(expected), static_cast<unsigned long long>(actual));
+		std::abort();
+	}
+	
+	template<typename T> const char* type_name();
+	template<> const char* type_name<std::int8_t>() { return "int8_t"; }
+	template<> const char* type_name<std::uint8_t>() { return "uint8_t"; }
+	template<> const char* type_name<std::int16_t>() { return "int16_t"; }
+	template<> const char* type_name<std::uint16_t>() { return "uint16_t"; }
+	template<> const char* type_name<std::int32_t>() { return "int32_t"; }
+	template<> const char* type_name<std::uint32_t>() { return "uint32_t"; }
+	template<> const char* type_name<std::int64_t>() { return "int64_t"; }
+	template<> const char* type_name<std::uint64_t>() { return "uint64_t"; }
+	
+	template<typename T, std::size_t S>
+	struct checker
+	{
+		using F = supsm::fixed<T, S>;
+		T a, b;
+		
+		void expect(const char* what, T expected, T actual) const
+		{
+			if (expected != actual)
+			{
+				fail(what, type_name<T>(), S, extend(a), extend(b), extend(expected), extend(actual));
+			}
+		}
+		static F make(T raw)
+		{
+			F result;
+			result.raw_data = raw;
+			return result;
+		}
+		
+		// x + y or x - y, which overflow like T
+		void add_sub() const
+		{
+			const i128 sum = static_cast<i128>(a) + b, difference = static_cast<i128>(a) - b;
+			const auto fits = [](i128 x) { return x >= std::numeric_limits<T>::min() && x <= std::numeric_limits<T>::max(); };
+			if (wraps<T> || fits(sum))
+			{
+				expect("+", wrap<T>(static_cast<u128>(sum)), (make(a) + make(b)).raw_data);
+			}
+			if (wraps<T> || fits(difference))
+			{
+				expect("-", wrap<T>(static_cast<u128>(difference)), (make(a) - make(b)).raw_data);
+			}
+		}
+		// bits [S, S + width) of the product of magnitudes, with the sign restored
+		void multiply() const
+		{
+			const u128 product = (magnitude(a) * magnitude(b)) >> S;
+			const bool negative = (a < 0) != (b < 0);
+			expect("*", wrap<T>(negative ? u128(0) - product : product), (make(a) * make(b)).raw_data);
+		}
+		// (|x| << shift) / |y| with the sign restored, checked whenever the quotient fits in width bits
+		// (the documented contract; wider quotients overflow)
+		// division by zero gives a quotient of all 1's, like the portable multiword division
+		template<std::size_t shift>
+		void check_quotient(const char* what, T x, T y, T actual) const
+		{
+			const bool negative = (x < 0) != (y < 0);
+			u128 quotient;
+			if (y == 0)
+			{
+				quotient = static_cast<unsigned_t<T>>(~unsigned_t<T>(0));
+			}
+			else
+			{
+				big q = big::shifted(magnitude(x), shift);
+				q /= static_cast<std::uint64_t>(magnitude(y));
+				if (!q.below(width<T>))
+				{
+					return;
+				}
+				quotient = q.words[0];
+			}
+			expect(what, wrap<T>(negative ? u128(0) - quotient : quotient), actual);
+		}
+		void divide() const
+		{
+			check_quotient<S>("/", a, b, (make(a) / make(b)).raw_data);
+			// integer / fixed
+			check_quotient<2 * S>("integer / fixed", a, b, (a / make(b)).raw_data);
+		}
+		// raw_data % raw_data and raw_data / raw_data, skipping the cases that are undefined for T
+		bool integer_division_defined() const
+		{
+			return b != 0 && (wraps<T> || !(a == std::numeric_limits<T>::min() && b == static_cast<T>(-1)));
+		}
+		void modulo() const
+		{
+			if (integer_division_defined())
+			{
+				const i128 remainder = static_cast<i128>(a) % static_cast<i128>(b);
+				expect("%", wrap<T>(static_cast<u128>(remainder)), (make(a) % make(b)).raw_data);
+				const auto [quotient, rem] = supsm::divmod(make(a), make(b));
+				expect("divmod quotient", wrap<T>(static_cast<u128>(static_cast<i128>(a) / static_cast<i128>(b))), quotient);
+				expect("divmod remainder", wrap<T>(static_cast<u128>(remainder)), rem.raw_data);
+			}
+		}
+		// value * 2^(to - S) in To, shifting right towards negative infinity
+		template<typename To>
+		void cast_to() const
+		{
+			using T2 = typename To::internal_type;
+			constexpr std::size_t to = To::fractional_bits;
+			u128 expected;
+			if constexpr (to >= S)
+			{
+				expected = extend(a) << (to - S);
+			}
+			else
+			{
+				expected = static_cast<u128>(static_cast<i128>(a) >> (S - to));
+			}
+			const T2 actual = supsm::fixed_cast<To>(make(a)).raw_data;
+			if (wrap<T2>(expected) != actual)
+			{
+				fail("fixed_cast", type_name<T>(), S, extend(a), to, extend(wrap<T2>(expected)), extend(actual));
+			}
+		}
+		void cast() const
+		{
+			cast_to<supsm::fixed<std::int8_t, 4>>();
+			cast_to<supsm::fixed<std::uint16_t, 8>>();
+			cast_to<supsm::fixed<std::int32_t, 16>>();
+			cast_to<supsm::fixed<std::uint64_t, 32>>();
+			cast_to<supsm::fixed<std::int64_t, 63>>();
+		}
+		// exact product of magnitudes shifted right by (n - 1) * S once, with the sign restored
+		void products(T c) const
+		{
+			big two = big::shifted(magnitude(a), 0);
+			two *= static_cast<std::uint64_t>(magnitude(b));
+			const bool negative2 = (a < 0) != (b < 0);
+			const u128 p2 = two.bits(S);
+			expect("product of 2", wrap<T>(negative2 ? u128(0) - p2 : p2), supsm::product(make(a), make(b)).raw_data);
+			
+			big three = two;
+			three *= static_cast<std::uint64_t>(magnitude(c));
+			const bool negative3 = negative2 != (c < 0);
+			const u128 p3 = three.bits(2 * S);
+			expect("product of 3", wrap<T>(negative3 ? u128(0) - p3 : p3), supsm::product(make(a), make(b), make(c)).raw_data);
+		}
+		// two's complement words of the exact raw product
+		void high_low() const
+		{
+			const u128 product = extend(a) * extend(b);
+			expect("mul_high", wrap<T>(product >> width<T>), supsm::mul_high(make(a), make(b)));
+			const unsigned_t<T> low = supsm::mul_low(make(a), make(b));
+			expect("mul_low", wrap<T>(product), static_cast<T>(low));
+		}
+		// a compared with integer i, exactly
+		void compare(std::int64_t i) const
+		{
+			const i128 scaled = static_cast<i128>(i) * (i128(1) << S);
+			const i128 value = static_cast<i128>(a);
+			const F x = make(a);
+			if ((x < i) != (value < scaled) || (x == i) != (value == scaled) || (x > i) != (value > scaled))
+			{
+				fail("integer comparison", type_name<T>(), S, extend(a), static_cast<u128>(static_cast<i128>(i)), value < scaled, x < i);
+			}
+		}
+		// a <=> b compares raw_data
+		void order() const
+		{
+			const F x = make(a), y = make(b);
+			const auto expected = a <=> b;
+			if ((x <=> y) != expected || (x == y) != (a == b) || (x < y) != (a < b))
+			{
+				fail("<=>", type_name<T>(), S, extend(a), extend(b), a < b, x < y);
+			}
+		}
+		
+		// whether the raw result of arithmetic in T (promoted to int for narrow T) is defined,
+		// i.e. T wraps or the exact result fits the type the arithmetic happens in
+		template<typename P = T>
+		static bool defined(i128 exact)
+		{
+			return std::is_unsigned_v<P> || (exact >= std::numeric_limits<P>::min() && exact <= std::numeric_limits<P>::max());
+		}
+		// raw_data of fixed(i), which shifts i in T
+		static T from_integer(T i, std::size_t shift = S)
+		{
+			return wrap<T>(extend(i) << shift);
+		}
+		
+		// bitwise operators, shifts and negation act on raw_data
+		void bitwise(unsigned amount) const
+		{
+			const F x = make(a), y = make(b);
+			expect("~", wrap<T>(~extend(a)), (~x).raw_data);
+			expect("&", static_cast<T>(a & b), (x & y).raw_data);
+			expect("|", static_cast<T>(a | b), (x | y).raw_data);
+			expect("^", static_cast<T>(a ^ b), (x ^ y).raw_data);
+			const unsigned n = amount % width<T>;
+			expect("<<", wrap<T>(extend(a) << n), (x << n).raw_data);
+			expect(">>", wrap<T>(static_cast<u128>(static_cast<i128>(a) >> n)), (x >> n).raw_data);
+			if (wraps<T> || a != std::numeric_limits<T>::min())
+			{
+				expect("unary -", wrap<T>(u128(0) - extend(a)), (-x).raw_data);
+			}
+		}
+		// integer constructors and integer + - * fixed, with i converted by shifting like fixed(i)
+		void integer_operators(T i, unsigned scale) const
+		{
+			const F y = make(b);
+			const T fi = from_integer(i);
+			expect("fixed(integer)", fi, F(i).raw_data);
+			const std::size_t k = scale % (S + 1);
+			expect("fixed(integer, scale)", from_integer(i, S - k), F(i, k).raw_data);
+			const i128 sum = static_cast<i128>(fi) + b, difference = static_cast<i128>(fi) - b;
+			if (wraps<T> || defined(sum))
+			{
+				expect("integer + fixed", wrap<T>(static_cast<u128>(sum)), (i + y).raw_data);
+			}
+			if (wraps<T> || defined(difference))
+			{
+				expect("integer - fixed", wrap<T>(static_cast<u128>(difference)), (i - y).raw_data);
+			}
+			// multiplying by an integer multiplies raw_data directly
+			using P = decltype(T() * T());
+			const i128 product = static_cast<i128>(i) * b;
+			if (defined<P>(product))
+			{
+				const T expected = wrap<T>(extend(i) * extend(b));
+				expect("integer * fixed", expected, (i * y).raw_data);
+				expect("fixed * integer", expected, (y * i).raw_data);
+			}
+		}
+		// explicit conversions: integers truncate towards negative infinity, floating point is exact up to rounding of raw_data
+		void conversions() const
+		{
+			const F x = make(a);
+			expect("operator T", wrap<T>(static_cast<u128>(static_cast<i128>(a) >> S)), static_cast<T>(x));
+			const std::int64_t wide = static_cast<std::int64_t>(a);
+			const std::int64_t expected_wide = static_cast<std::int64_t>(static_cast<i128>(wide) >> S);
+			if (static_cast<std::int64_t>(x) != expected_wide)
+			{
+				fail("operator int64_t", type_name<T>(), S, extend(a), 0, static_cast<u128>(static_cast<i128>(expected_wide)), static_cast<u128>(static_cast<i128>(static_cast<std::int64_t>(x))));
+			}
+			const double expected_double = std::ldexp(static_cast<double>(a), -static_cast<int>(S));
+			const float expected_float = std::ldexp(static_cast<float>(a), -static_cast<int>(S));
+			if (static_cast<double>(x) != expected_double || static_cast<float>(x) != expected_float)
+			{
+				fail("operator double/float", type_name<T>(), S, extend(a), 0, 0, 0);
+			}
+		}
+		// rounding functions clear the fractional bits after adding an offset, wrapping like T
+		void rounding() const
+		{
+			const F x = make(a);
+			const i128 value = static_cast<i128>(a), one = i128(1) << S;
+			const i128 floor = (value >> S) << S;
+			const i128 ceil = floor == value ? value : floor + one;
+			const i128 trunc = value < 0 ? ceil : floor;
+			// halves away from zero
+			const i128 half = one >> 1;
+			const i128 round = S == 0 ? value : value < 0 ? -(((half - value) >> S) << S) : ((value + half) >> S) << S;
+			expect("floor", wrap<T>(static_cast<u128>(floor)), supsm::floor(x).raw_data);
+			expect("ceil", wrap<T>(static_cast<u128>(ceil)), supsm::ceil(x).raw_data);
+			expect("trunc", wrap<T>(static_cast<u128>(trunc)), supsm::trunc(x).raw_data);
+			expect("round", wrap<T>(static_cast<u128>(round)), supsm::round(x).raw_data);
+			expect("frac", wrap<T>(static_cast<u128>(value - floor)), supsm::frac(x).raw_data);
+			F integral;
+			const F fractional = supsm::modf(x, &integral);
+			expect("modf integral", wrap<T>(static_cast<u128>(trunc)), integral.raw_data);
+			expect("modf fractional", wrap<T>(static_cast<u128>(value - trunc)), fractional.raw_data);
+		}
+		// branch-free helpers, reciprocal and mul_wide
+		void helpers(T c) const
+		{
+			const F x = make(a), y = make(b), z = make(c);
+			const T abs_a = wrap<T>(magnitude(a));
+			expect("abs", abs_a, supsm::abs(x).raw_data);
+			expect("min", std::min(a, b), supsm::min(x, y).raw_data);
+			expect("max", std::max(a, b), supsm::max(x, y).raw_data);
+			const T lo = std::min(b, c), hi = std::max(b, c);
+			expect("clamp", std::clamp(a, lo, hi), supsm::clamp(x, supsm::min(y, z), supsm::max(y, z)).raw_data);
+			expect("copysign", b < 0 ? wrap<T>(u128(0) - magnitude(a)) : abs_a, supsm::copysign(x, y).raw_data);
+			expect("signum", static_cast<T>((a > 0) - (a < 0)), static_cast<T>(supsm::signum(x)));
+			check_quotient<2 * S>("reciprocal", T(1), a, supsm::reciprocal(x).raw_data);
+			if constexpr (width<T> <= 32)
+			{
+				const auto wide = supsm::mul_wide(x, y);
+				using W = typename decltype(wide)::internal_type;
+				static_assert(decltype(wide)::fractional_bits == 2 * S);
+				if (wide.raw_data != static_cast<W>(static_cast<i128>(a) * b))
+				{
+					fail("mul_wide", type_name<T>(), S, extend(a), extend(b), static_cast<u128>(static_cast<i128>(a) * b), extend(wide.raw_data));
+				}
+			}
+		}
+	};
+	
+	template<typename T, std::size_t S>
+	void run(input& in)
+	{
+		const checker<T, S> check{ in.value<T>(), in.value<T>() };
+		switch (in.byte() % 14)
+		{
+			case 0: check.add_sub(); break;
+			case 1: check.multiply(); break;
+			case 2: check.divide(); break;
+			case 3: check.modulo(); break;
+			case 4: check.cast(); break;
+			case 5: check.products(in.value<T>()); break;
+			case 6: check.high_low(); break;
+			case 7: check.compare(in.value<std::int64_t>()); break;
+			case 8: check.order(); break;
+			case 9: check.bitwise(in.byte()); break;
+			case 10: check.integer_operators(in.value<T>(), in.byte()); break;
+			case 11: check.conversions(); break;
+			case 12: check.rounding(); break;
+			case 13: check.helpers(in.value<T>()); break;
+		}
+	}
+	
+	using runner = void (*)(input&);
+	template<typename T>
+	constexpr std::array<runner, 3> runners_for = { &run<T, 0>, &run<T, width<T> / 2>, &run<T, width<T> - 1> };
+	constexpr std::array<std::array<runner, 3>, 8> runners = {
+		runners_for<std::int8_t>, runners_for<std::uint8_t>, runners_for<std::int16_t>, runners_for<std::uint16_t>,
+		runners_for<std::int32_t>, runners_for<std::uint32_t>, runners_for<std::int64_t>, runners_for<std::uint64_t>,
+	};
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size)
+{
+	// each check reads a format byte, an operation byte and its operands
+	input in(data, size);
+	while (!in.empty())
+	{
+		const std::uint8_t format = in.byte();
+		runners[format % 8][format / 8 % 3](in);
+	}
+	return 0;
+}
+
+#if defined(FUZZ_STANDALONE)
+int main(int argc, char** argv)
+{
+	const unsigned long iterations = argc > 1 ? std::stoul(argv[1]) : 1000000;
+	std::mt19937_64 rng(0);
+	std::vector<std::uint8_t> buffer(64);
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		for (std::uint8_t& byte : buffer)
+		{
+			byte = static_cast<std::uint8_t>(rng());
+		}
+		LLVMFuzzerTestOneInput(buffer.data(), buffer.size());
+	}
+	std::printf("%lu inputs passed\n", iterations);
+}
+#endif